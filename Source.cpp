@@ -1,6 +1,8 @@
 #include <iostream>         // cout, cerr
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>
 #include <GL/glew.h>        // GLEW library
 #include <GLFW/glfw3.h>     // GLFW library
 
@@ -10,8 +12,14 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "meshes.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "material.h"
+#include "gpuresources.h"
+#include "samplers.h"
+#include "texturestreamer.h"
+#include "textureatlas.h"
+#include "resources.h"
+#include "dynamicmesh.h"
+#include "primitives.h"
 
 using namespace std; // Standard namespace
 
@@ -34,37 +42,20 @@ float fov = 45.0f;
 float movementSpeed = 0.05f;
 bool isOrthographic = false;
 
-GLuint gTexture1Id;
-GLuint gTexture2Id;
-GLuint gTexture3Id;
-GLuint gTexture4Id;
-GLuint gTexture5Id;
+// Shared through gResources, which hands each file out once
+ResourceManager::TextureHandle gTexture1;
+ResourceManager::TextureHandle gTexture2;
+ResourceManager::TextureHandle gTexture3;
+// Uploads the textures a few rows at a time between frames
+TextureStreamer gTextureStreamer;
+// The small sun and button textures share one page
+TextureAtlas gTextureAtlas;
+enum AtlasRegion { SunRegion, MultiRegion };
 
-// Function to create a texture from an image file using stb_image
-bool UCreateTexture(const char* filename, GLuint& textureId)
-{
-	int width, height, channels;
-	unsigned char* image = stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
-
-	if (!image)
-	{
-		std::cerr << "Error loading texture: " << filename << std::endl;
-		return false;
-	}
-
-	glGenTextures(1, &textureId);
-	glBindTexture(GL_TEXTURE_2D, textureId);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	stbi_image_free(image);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	return true;
-}
 // Function prototypes
 void UUpdateCamera();
+void URequestTexture(GLuint textureId, Meshes::MeshId mesh, const glm::mat4& model);
+void URequestTexture(GLuint textureId, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model);
 void UProcessInput(GLFWwindow* window);
 void UMouseCallback(GLFWwindow* window, double xpos, double ypos);
 void URender();
@@ -110,6 +101,15 @@ namespace
 
 	//Shape Meshes from Professor Brian
 	Meshes meshes;
+
+	// Textures and models, loaded once per file however many draws use them
+	ResourceManager gResources(gTextureStreamer, meshes);
+
+	// With --animate-washer the large washer breathes: its torus is rebuilt
+	// every frame through a dynamic mesh. Off by default.
+	bool gAnimateWasher = false;
+	DynamicMesh gWasher;
+	constexpr Primitives::RingTable<30> gWasherRing = Primitives::MakeRing<30>();
 }
 
 /* User-defined Function prototypes to:
@@ -140,15 +140,29 @@ out vec2 vertexTextureCoordinate;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool ubOctNormals; // Normals arrive octahedral-encoded in xy (Meshes packed vertex layout)
+uniform vec4 uvScaleOffset = vec4(1.0, 1.0, 0.0, 0.0); // Texture atlas region, (1, 1, 0, 0) for a whole texture
+
+// Unfold an octahedral-encoded normal back onto the unit sphere
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
 
 void main()
 {
+	vec3 normal = ubOctNormals ? octDecode(vertexNormal.xy) : vertexNormal;
+
 	gl_Position = projection * view * model * vec4(vertexPosition, 1.0f); // Transforms vertices into clip coordinates
 
 	vertexFragmentPos = vec3(model * vec4(vertexPosition, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
 
-	vertexFragmentNormal = mat3(transpose(inverse(model))) * vertexNormal; // get normal vectors in world space only and exclude normal translation properties
-	vertexTextureCoordinate = textureCoordinate;
+	vertexFragmentNormal = mat3(transpose(inverse(model))) * normal; // get normal vectors in world space only and exclude normal translation properties
+	vertexTextureCoordinate = textureCoordinate * uvScaleOffset.xy + uvScaleOffset.zw;
 }
 );
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -240,8 +254,6 @@ void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void URender();
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
 void UDestroyShaderProgram(GLuint programId);
-bool UCreateTexture(const char* filename, GLuint& textureId);
-void UDestroyTexture(GLuint textureId);
 int main(int argc, char* argv[])
 {
 	if (!UInitialize(argc, argv, &gWindow))
@@ -258,10 +270,29 @@ int main(int argc, char* argv[])
 	//UCreateMesh(gMesh); // Calls the function to create the Vertex Buffer Object
 	meshes.CreateMeshes();
 
+	// the dynamic mesh stores float vertices, so it only shares the
+	// shader with meshes that do too
+	for (int i = 1; i < argc; i++)
+		gAnimateWasher |= std::strcmp(argv[i], "--animate-washer") == 0;
+	if (gAnimateWasher && meshes.settings.packedVertices)
+	{
+		cout << "WARNING: --animate-washer needs float vertices, the washer stays still" << endl;
+		gAnimateWasher = false;
+	}
+	if (gAnimateWasher)
+	{
+		Primitives::MeshSize washerSize = Primitives::TorusSize(gWasherRing.View().segments, gWasherRing.View().segments);
+		if (!gWasher.Create(washerSize.nVertices, washerSize.nIndices))
+			return EXIT_FAILURE;
+	}
+
 	// Create the shader program
 	if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId))
 		return EXIT_FAILURE;
 
+	// Tell the vertex shader which normal encoding the meshes were stored with
+	glUniform1i(glGetUniformLocation(gProgramId, "ubOctNormals"), meshes.settings.packedVertices);
+
 	glfwSetInputMode(gWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glfwSetCursorPosCallback(gWindow, UMouseCallback);
 
@@ -270,71 +301,72 @@ int main(int argc, char* argv[])
 
 	// Sets the background color of the window to black (it will be implicitely used by glClear)
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	// Load textures
-	const char* texFilename = "checker.jpg";
-	if (!UCreateTexture(texFilename, gTexture1Id))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
+	// Load textures; they decode and compress to BC1 (BC3 with alpha) in
+	// parallel and stream in over the first frames, showing a flat
+	// placeholder until their first mips arrive
+	TextureStreamer::Settings textureSettings;
+	textureSettings.compression = TextureStreamer::Compression::BC1OrBC3;
+	// levels finer than the draws need are only kept while they fit
+	textureSettings.budgetBytes = 64 << 20;
+	if (!gTextureStreamer.Create(textureSettings))
 		return EXIT_FAILURE;
-	}
-
-	texFilename = "metal.jpg";  // Use the metal texture
-	if (!UCreateTexture(texFilename, gTexture2Id))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
+	gTexture1 = gResources.AcquireTexture("checker.jpg");
+	gTexture2 = gResources.AcquireTexture("metal.jpg");
+	gTexture3 = gResources.AcquireTexture("grid.png");
+	const char* const atlasPaths[] = { "sun.png", "multi.png" };
+	if (!gTextureAtlas.Build(atlasPaths, sizeof(atlasPaths) / sizeof(atlasPaths[0])))
 		return EXIT_FAILURE;
-	}
-
-	texFilename = "grid.png";  // Use the grid texture
-	if (!UCreateTexture(texFilename, gTexture3Id))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
-		return EXIT_FAILURE;
-	}
-
-	texFilename = "sun.png"; // Use the sun texture
-	if (!UCreateTexture(texFilename, gTexture4Id))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
-		return EXIT_FAILURE;
-	}
 
-	texFilename = "multi.png"; // Use the sun texture
-	if (!UCreateTexture(texFilename, gTexture5Id))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
+	// Filtering comes from the samplers each material binds
+	if (!Samplers::Create())
 		return EXIT_FAILURE;
-	}
 
 	// bind textures on corresponding texture units
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, gTexture2Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture2));
 
 	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, gTexture3Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture3));
 	
 	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, gTexture4Id);
+	glBindTexture(GL_TEXTURE_2D, gTextureAtlas.regions[SunRegion].texture);
 
 	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_2D, gTexture5Id);
+	glBindTexture(GL_TEXTURE_2D, gTextureAtlas.regions[MultiRegion].texture);
+
+	GpuResources::ReportUsage();
+
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(gWindow)) {
 		UProcessInput(gWindow);
 		UUpdateCamera();
+		gTextureStreamer.Update();
+		gResources.Update();
 		URender();
 		glfwPollEvents();
 	}
 	// Release mesh data
 	//UDestroyMesh(gMesh);
 	meshes.DestroyMeshes();
+	gWasher.Destroy();
+
+	// Release textures
+	gResources.Release(gTexture1);
+	gResources.Release(gTexture2);
+	gResources.Release(gTexture3);
+	gResources.Destroy();
+	gTextureStreamer.Destroy();
+	gTextureAtlas.Destroy();
+	Samplers::Destroy();
 
 	// Release shader program
 	UDestroyShaderProgram(gProgramId);
+
+	GpuResources::ReportLeaks();
 	glfwTerminate(); // Terminates GLFW before exiting
 	exit(EXIT_SUCCESS); // Terminates the program successfully
 }
@@ -520,6 +552,7 @@ void URender()
 	GLint specInt2Loc;
 	GLint highlghtSz2Loc;
 	GLint uHasTextureLoc;
+	GLint uvScaleOffsetLoc;
 	bool ubHasTextureVal;
 	glm::mat4 scale;
 	glm::mat4 rotation;
@@ -557,6 +590,11 @@ void URender()
 	specInt2Loc = glGetUniformLocation(gProgramId, "specularIntensity2");
 	highlghtSz2Loc = glGetUniformLocation(gProgramId, "highlightSize2");
 	uHasTextureLoc = glGetUniformLocation(gProgramId, "ubHasTexture");
+	uvScaleOffsetLoc = glGetUniformLocation(gProgramId, "uvScaleOffset");
+
+	// whole textures until a draw samples from the atlas
+	const glm::vec4 wholeTexture(1.0f, 1.0f, 0.0f, 0.0f);
+	glUniform4fv(uvScaleOffsetLoc, 1, glm::value_ptr(wholeTexture));
 
 	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
 	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
@@ -618,13 +656,13 @@ void URender()
 	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
 	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, gTexture3Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture3));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPlaneMesh.vao);
+	// Activate the shared VAO that holds every mesh
+	glBindVertexArray(meshes.vao);
 
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(6.0f, 1.0f, 6.0f));
@@ -638,20 +676,16 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 0.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
+	Materials::Apply(Materials::twoSided, model);
 	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture3), Meshes::PlaneMesh, model);
+	meshes.Draw(Meshes::PlaneMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
 
-	// Activate the VBOs contained within the mesh's VAO
 	if (!isOrthographic) {
 		// Rendering code for the plane
-		glBindVertexArray(meshes.gPlaneMesh.vao);
-
 		// 1. Scales the object
 		scale = glm::scale(glm::vec3(6.0f, 1.0f, 6.0f));
 		// 2. Rotate the object
@@ -664,16 +698,12 @@ void URender()
 
 		glProgramUniform4f(gProgramId, objColLoc, 1.0f, 0.0f, 0.0f, 1.0f);
 
+		Materials::Apply(Materials::twoSided, model);
 		// Draws the triangles
-		glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+		meshes.Draw(Meshes::PlaneMesh);
 
-		// Deactivate the Vertex Array Object
-		glBindVertexArray(0);
 	}
 
-	// Activate the VBOs contained within the mesh's VAO
-	//glBindVertexArray(meshes.gPyramid3Mesh.vao);
-
 	// 1. Scales the object
 	//scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
 	// 2. Rotate the object
@@ -687,9 +717,8 @@ void URender()
 	//glProgramUniform4f(gProgramId, objectColorLoc, 0.0f, 0.5f, 0.5f, 1.0f);
 
 	// Draws the triangles
-	//glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPyramid3Mesh.nVertices);
+	//meshes.Draw(Meshes::Pyramid3Mesh);
 
-	// Deactivate the Vertex Array Object
 	
 	
 	///////////////////////////////////////////////////////////////This is for the main cylinder
@@ -697,14 +726,11 @@ void URender()
 	
 	//glBindVertexArray(0);
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.5f, 2.0f, 0.5f));
 	//(Width,Height,
@@ -721,13 +747,10 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture1), Meshes::CylinderMesh, model);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -737,13 +760,10 @@ void URender()
 
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
-// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gBoxMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(3.0f, 0.35f, 0.6f));
 	// 2. Rotate the object
@@ -756,25 +776,21 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 0.5f, 0.5f, 0.0f, 1.0f);
 
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gBoxMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture1), Meshes::BoxMesh, model);
+	meshes.Draw(Meshes::BoxMesh);
 
 
 	//////////////////////////////////////////////////////////////This is the Washer
 
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.5f, 0.1f, 0.5f));
 	//(Width,Height,
@@ -791,13 +807,10 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture1), Meshes::CylinderMesh, model);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -809,13 +822,10 @@ void URender()
 
 // Activate the texture unit and bind the texture for the Torus
 	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, gTexture2Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture2));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 1);
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTorusMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.2f, 0.2f, 0.5f));
 	// 2. Rotate the object
@@ -829,11 +839,10 @@ void URender()
 	scale = glm::scale(glm::vec3(1.0f, 1.0f, 0.5f));
 
 	glProgramUniform4f(gProgramId, objColLoc, 0.0f, 0.0f, 1.0f, 1.0f);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture2), Meshes::TorusMesh, model);
+	meshes.Draw(Meshes::TorusMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -846,14 +855,12 @@ void URender()
 	
 	
 	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_2D, gTexture5Id);
+	glBindTexture(GL_TEXTURE_2D, gTextureAtlas.regions[MultiRegion].texture);
+	glUniform4fv(uvScaleOffsetLoc, 1, glm::value_ptr(gTextureAtlas.regions[MultiRegion].uvScaleOffset));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.3f, 0.1f, 0.3f));
 	//(Width,Height,
@@ -870,13 +877,9 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -886,14 +889,12 @@ void URender()
 
 
 	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_2D, gTexture5Id);
+	glBindTexture(GL_TEXTURE_2D, gTextureAtlas.regions[MultiRegion].texture);
+	glUniform4fv(uvScaleOffsetLoc, 1, glm::value_ptr(gTextureAtlas.regions[MultiRegion].uvScaleOffset));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.3f, 0.1f, 0.3f));
 	//(Width,Height,
@@ -909,30 +910,24 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
+	glUniform4fv(uvScaleOffsetLoc, 1, glm::value_ptr(wholeTexture));
 
 	///////////////////////////////////////////////////////////////This is for the top of the angled screw
 
 
 //glBindVertexArray(0);
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.1f, -0.57f, 0.1f));
 	//(Width,Height,
@@ -948,13 +943,10 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture1), Meshes::CylinderMesh, model);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -965,14 +957,11 @@ void URender()
 
 //glBindVertexArray(0);
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.3f, 0.1f, 0.3f));
 	//(Width,Height,
@@ -988,13 +977,10 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture1), Meshes::CylinderMesh, model);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -1005,13 +991,10 @@ void URender()
 
 // Activate the texture unit and bind the texture for the Torus
 	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, gTexture2Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture2));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 1);
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gTorusMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.5f, 0.5f, 1.0f));
 	// 2. Rotate the object
@@ -1025,11 +1008,32 @@ void URender()
 	scale = glm::scale(glm::vec3(1.0f, 1.0f, 0.5f));
 
 	glProgramUniform4f(gProgramId, objColLoc, 0.0f, 0.0f, 1.0f, 1.0f);
-	// Draws the triangles
-	glDrawArrays(GL_TRIANGLES, 0, meshes.gTorusMesh.nVertices);
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	Materials::Apply(Materials::solid, model);
+	if (gAnimateWasher)
+	{
+		// Rebuild the washer with its tube swelling and shrinking over time
+		const float swell = 0.25f;
+		MeshBuilder washer = gWasher.Begin();
+		float tubeRadius = meshes.settings.torusTubeRadius * (1.0f + swell * std::sin(2.0f * float(glfwGetTime())));
+		Primitives::Torus(meshes.settings.torusMainRadius, tubeRadius, gWasherRing.View(), gWasherRing.View(),
+			washer.Vertices(), washer.Indices());
+		washer.MarkFull();
+		gWasher.End(washer);
+
+		// texture levels are picked for the fattest tube
+		const Meshes::GLMesh& torus = meshes.Mesh(Meshes::TorusMesh);
+		glm::vec3 growth(swell * meshes.settings.torusTubeRadius);
+		URequestTexture(gResources.Texture(gTexture2), torus.boundsMin - growth, torus.boundsMax + growth, model);
+		glBindVertexArray(gWasher.vao);
+		gWasher.Draw();
+		glBindVertexArray(meshes.vao);
+	}
+	else
+	{
+		// Draws the triangles
+		URequestTexture(gResources.Texture(gTexture2), Meshes::TorusMesh, model);
+		meshes.Draw(Meshes::TorusMesh);
+	}
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -1039,14 +1043,11 @@ void URender()
 
 //glBindVertexArray(0);
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.3f, 0.1f, 0.3f));
 	//(Width,Height,
@@ -1062,13 +1063,10 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture1), Meshes::CylinderMesh, model);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -1079,14 +1077,11 @@ void URender()
 
 //glBindVertexArray(0);
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, gTexture1Id);
+	glBindTexture(GL_TEXTURE_2D, gResources.Texture(gTexture1));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gCylinderMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(0.1f, -0.65f, 0.1f));
 	//(Width,Height,
@@ -1102,13 +1097,10 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 1.0f, 1.0f, 0.0f, 1.0f);
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 36);		//bottom
-	glDrawArrays(GL_TRIANGLE_FAN, 36, 36);		//top
-	glDrawArrays(GL_TRIANGLE_STRIP, 72, 146);	//sides
-
-	// Deactivate the Vertex Array Object
-	glBindVertexArray(0);
+	URequestTexture(gResources.Texture(gTexture1), Meshes::CylinderMesh, model);
+	meshes.Draw(Meshes::CylinderMesh);
 
 	// Unbind the texture
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -1118,14 +1110,12 @@ void URender()
 
 
 	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, gTexture4Id);
+	glBindTexture(GL_TEXTURE_2D, gTextureAtlas.regions[SunRegion].texture);
+	glUniform4fv(uvScaleOffsetLoc, 1, glm::value_ptr(gTextureAtlas.regions[SunRegion].uvScaleOffset));
 
 	// Set the texture unit uniform in the shader
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 3);
 
-	// Activate the VBOs contained within the mesh's VAO
-	//glBindVertexArray(meshes.gSphereMesh.vao);
-
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
 	// 2. Rotate the object
@@ -1138,8 +1128,9 @@ void URender()
 
 	glProgramUniform4f(gProgramId, objColLoc, 0.0f, 1.0f, 0.0f, 1.0f);
 
+	Materials::Apply(Materials::solid, model);
 	// Draws the triangles
-	glDrawElements(GL_TRIANGLES, meshes.gSphereMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	meshes.Draw(Meshes::SphereMesh);
 
 	// Deactivate the Vertex Array Object
 	glBindVertexArray(0);
@@ -1151,6 +1142,23 @@ void URender()
 	glfwSwapBuffers(gWindow);    // Flips the the back buffer with the front buffer every frame.
 }
 
+// Tell the streamer how large a texture is drawn on mesh this frame, so it
+// keeps just the levels that size needs
+void URequestTexture(GLuint textureId, Meshes::MeshId mesh, const glm::mat4& model)
+{
+	const Meshes::GLMesh& drawn = meshes.Mesh(mesh);
+	URequestTexture(textureId, drawn.boundsMin, drawn.boundsMax, model);
+}
+
+void URequestTexture(GLuint textureId, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model)
+{
+	glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
+	glm::mat4 projection = isOrthographic ? glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f)
+		: glm::perspective(glm::radians(45.0f), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	gTextureStreamer.Request(textureId,
+		TextureStreamer::ScreenSize(boundsMin, boundsMax, model, view, projection, WINDOW_HEIGHT));
+}
+
 void UUpdateCamera() {
 	glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
 	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
@@ -1164,11 +1172,11 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	char infoLog[512];
 
 	// Create a Shader program object.
-	programId = glCreateProgram();
+	programId = GpuResources::CreateProgram("surface shader");
 
 	// Create the vertex and fragment shader objects
-	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	GLuint vertexShaderId = GpuResources::CreateShader(GL_VERTEX_SHADER, "surface vertex shader");
+	GLuint fragmentShaderId = GpuResources::CreateShader(GL_FRAGMENT_SHADER, "surface fragment shader");
 
 	// Retrive the shader source
 	glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
@@ -1202,6 +1210,10 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	glAttachShader(programId, fragmentShaderId);
 
 	glLinkProgram(programId);   // links the shader program
+
+	// the program keeps what it needs; the shaders go once it is deleted
+	GpuResources::DeleteShader(vertexShaderId);
+	GpuResources::DeleteShader(fragmentShaderId);
 	// Retrieve uniform locations after linking
 	viewLoc = glGetUniformLocation(programId, "view");
 	// check for linking errors
@@ -1222,5 +1234,5 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 
 void UDestroyShaderProgram(GLuint programId)
 {
-	glDeleteProgram(programId);
-}
\ No newline at end of file
+	GpuResources::DeleteProgram(programId);
+}
\ No newline at end of file
@@ -0,0 +1,456 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompress.cpp
+// ========
+// CPU encoder for the BC1, BC3 and BC7 block compressed texture formats
+///////////////////////////////////////////////////////////////////////////////
+
+#include "blockcompress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCKCOMPRESS_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	using BlockCompress::blockSize;
+
+	const int nTexels = blockSize * blockSize;
+
+	// One block of texels as separate channel arrays, values 0 to 255
+	struct Block
+	{
+		alignas(16) float channel[4][nTexels];	// r, g, b, a
+	};
+
+	// Copy the block at (bx, by) blocks, repeating edge texels past the
+	// image. Gray fills r, g and b, and a second channel is alpha, so gray
+	// images sample as gray from the RGB block formats.
+	void Gather(const unsigned char* pixels, int width, int height, int channels, int bx, int by, Block& block)
+	{
+		for (int j = 0; j < blockSize; j++)
+		{
+			int y = std::min(by * blockSize + j, height - 1);
+			const unsigned char* row = pixels + std::size_t(y) * width * channels;
+			for (int i = 0; i < blockSize; i++)
+			{
+				int x = std::min(bx * blockSize + i, width - 1);
+				const unsigned char* texel = row + std::size_t(x) * channels;
+				int t = j * blockSize + i;
+				for (int c = 0; c < 3; c++)
+					block.channel[c][t] = float(texel[channels < 3 ? 0 : c]);
+				block.channel[3][t] = channels == 2 || channels == 4 ? float(texel[channels - 1]) : 255.0f;
+			}
+		}
+	}
+
+	void Bounds(const Block& block, float lo[4], float hi[4])
+	{
+#ifdef BLOCKCOMPRESS_SSE
+		for (int c = 0; c < 4; c++)
+		{
+			const float* values = block.channel[c];
+			__m128 vMin = _mm_min_ps(_mm_min_ps(_mm_load_ps(values), _mm_load_ps(values + 4)),
+				_mm_min_ps(_mm_load_ps(values + 8), _mm_load_ps(values + 12)));
+			__m128 vMax = _mm_max_ps(_mm_max_ps(_mm_load_ps(values), _mm_load_ps(values + 4)),
+				_mm_max_ps(_mm_load_ps(values + 8), _mm_load_ps(values + 12)));
+			vMin = _mm_min_ps(vMin, _mm_shuffle_ps(vMin, vMin, _MM_SHUFFLE(1, 0, 3, 2)));
+			vMin = _mm_min_ps(vMin, _mm_shuffle_ps(vMin, vMin, _MM_SHUFFLE(2, 3, 0, 1)));
+			vMax = _mm_max_ps(vMax, _mm_shuffle_ps(vMax, vMax, _MM_SHUFFLE(1, 0, 3, 2)));
+			vMax = _mm_max_ps(vMax, _mm_shuffle_ps(vMax, vMax, _MM_SHUFFLE(2, 3, 0, 1)));
+			lo[c] = _mm_cvtss_f32(vMin);
+			hi[c] = _mm_cvtss_f32(vMax);
+		}
+#else
+		for (int c = 0; c < 4; c++)
+		{
+			lo[c] = *std::min_element(block.channel[c], block.channel[c] + nTexels);
+			hi[c] = *std::max_element(block.channel[c], block.channel[c] + nTexels);
+		}
+#endif
+	}
+
+	///////////////////////////////////////////////////
+	//	Endpoints(const Block&, int, float*, float*)
+	//
+	//	nChannels: 3 for color only, 4 with alpha
+	//	e0, e1: receive the ends of the line the block's texels lie along
+	//
+	//	The bounding box's main diagonal, flipped in the channels that fall
+	//	while the widest channel rises, and inset by 1/16 of its length so
+	//	the interpolated colors cover the texels instead of the extremes
+	///////////////////////////////////////////////////
+	void Endpoints(const Block& block, int nChannels, float e0[4], float e1[4])
+	{
+		float lo[4], hi[4];
+		Bounds(block, lo, hi);
+
+		int widest = 0;
+		for (int c = 1; c < nChannels; c++)
+		{
+			if (hi[c] - lo[c] > hi[widest] - lo[widest])
+				widest = c;
+		}
+
+		float mean[4] = {};
+		for (int c = 0; c < nChannels; c++)
+		{
+			for (int t = 0; t < nTexels; t++)
+				mean[c] += block.channel[c][t];
+			mean[c] /= float(nTexels);
+		}
+
+		for (int c = 0; c < nChannels; c++)
+		{
+			e0[c] = lo[c];
+			e1[c] = hi[c];
+			if (c == widest)
+				continue;
+
+			float covariance = 0.0f;
+			for (int t = 0; t < nTexels; t++)
+				covariance += (block.channel[widest][t] - mean[widest]) * (block.channel[c][t] - mean[c]);
+			if (covariance < 0.0f)
+				std::swap(e0[c], e1[c]);
+		}
+
+		for (int c = 0; c < nChannels; c++)
+		{
+			float inset = (e1[c] - e0[c]) / 16.0f;
+			e0[c] += inset;
+			e1[c] -= inset;
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	Project(const Block&, int, const float*, const float*, int, int*)
+	//
+	//	steps: steps from e0 to e1
+	//	positions: receive, per texel, the nearest of the steps + 1 evenly
+	//	spaced points from e0 (0) to e1 (steps)
+	///////////////////////////////////////////////////
+	void Project(const Block& block, int nChannels, const float e0[4], const float e1[4], int steps, int positions[nTexels])
+	{
+		float axis[4] = {};
+		float lengthSq = 0.0f;
+		for (int c = 0; c < nChannels; c++)
+		{
+			axis[c] = e1[c] - e0[c];
+			lengthSq += axis[c] * axis[c];
+		}
+		if (lengthSq <= 0.0f)
+		{
+			std::fill(positions, positions + nTexels, 0);
+			return;
+		}
+		float scale = float(steps) / lengthSq;
+
+#ifdef BLOCKCOMPRESS_SSE
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 last = _mm_set1_ps(float(steps));
+		for (int t = 0; t < nTexels; t += 4)
+		{
+			__m128 dot = zero;
+			for (int c = 0; c < nChannels; c++)
+			{
+				__m128 offset = _mm_sub_ps(_mm_load_ps(block.channel[c] + t), _mm_set1_ps(e0[c]));
+				dot = _mm_add_ps(dot, _mm_mul_ps(offset, _mm_set1_ps(axis[c])));
+			}
+			__m128 position = _mm_min_ps(_mm_max_ps(_mm_mul_ps(dot, _mm_set1_ps(scale)), zero), last);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(positions + t), _mm_cvtps_epi32(position));
+		}
+#else
+		for (int t = 0; t < nTexels; t++)
+		{
+			float dot = 0.0f;
+			for (int c = 0; c < nChannels; c++)
+				dot += (block.channel[c][t] - e0[c]) * axis[c];
+			float position = std::min(std::max(dot * scale, 0.0f), float(steps));
+			positions[t] = int(position + 0.5f);
+		}
+#endif
+	}
+
+	std::uint16_t To565(const float color[4])
+	{
+		int r = int(std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+		int g = int(std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+		int b = int(std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+		return std::uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	void From565(std::uint16_t packed, float color[4])
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = float((r << 3) | (r >> 2));
+		color[1] = float((g << 2) | (g >> 4));
+		color[2] = float((b << 3) | (b >> 2));
+	}
+
+	void Store16(unsigned char* out, std::uint16_t value)
+	{
+		out[0] = (unsigned char)(value & 0xFF);
+		out[1] = (unsigned char)(value >> 8);
+	}
+
+	///////////////////////////////////////////////////
+	//	EncodeColor(const Block&, unsigned char*)
+	//
+	//	8 byte BC1 color block, always in 4 color mode (color0 > color1),
+	//	which is also the only mode the color half of BC3 has
+	///////////////////////////////////////////////////
+	void EncodeColor(const Block& block, unsigned char* out)
+	{
+		// palette order from e0 to e1 as BC1 indexes it
+		static const std::uint32_t paletteIndex[4] = { 0, 2, 3, 1 };
+
+		float e0[4], e1[4];
+		Endpoints(block, 3, e0, e1);
+		std::uint16_t c0 = To565(e0);
+		std::uint16_t c1 = To565(e1);
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		std::uint32_t indices = 0;
+		if (c0 != c1)
+		{
+			// project onto the endpoints as the GPU will decode them
+			From565(c0, e0);
+			From565(c1, e1);
+			int positions[nTexels];
+			Project(block, 3, e0, e1, 3, positions);
+			for (int t = 0; t < nTexels; t++)
+				indices |= paletteIndex[positions[t]] << (2 * t);
+		}
+
+		Store16(out, c0);
+		Store16(out + 2, c1);
+		for (int i = 0; i < 4; i++)
+			out[4 + i] = (unsigned char)(indices >> (8 * i));
+	}
+
+	///////////////////////////////////////////////////
+	//	EncodeAlpha(const Block&, unsigned char*)
+	//
+	//	8 byte BC3 alpha block in 8 value mode (alpha0 > alpha1)
+	///////////////////////////////////////////////////
+	void EncodeAlpha(const Block& block, unsigned char* out)
+	{
+		float lo[4], hi[4];
+		Bounds(block, lo, hi);
+		int a0 = int(hi[3]);
+		int a1 = int(lo[3]);
+
+		std::uint64_t indices = 0;
+		if (a0 != a1)
+		{
+			// project alpha alone, moved into the first channel
+			Block alpha;
+			std::memcpy(alpha.channel[0], block.channel[3], sizeof(alpha.channel[0]));
+			float e0[4] = { float(a0) };
+			float e1[4] = { float(a1) };
+
+			// steps 1 to 6 between the endpoints are indices 2 to 7
+			int positions[nTexels];
+			Project(alpha, 1, e0, e1, 7, positions);
+			for (int t = 0; t < nTexels; t++)
+			{
+				std::uint64_t index = positions[t] == 0 ? 0 : positions[t] == 7 ? 1 : std::uint64_t(positions[t] + 1);
+				indices |= index << (3 * t);
+			}
+		}
+
+		out[0] = (unsigned char)a0;
+		out[1] = (unsigned char)a1;
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (unsigned char)(indices >> (8 * i));
+	}
+
+	// Little endian bit stream filling a 16 byte block
+	struct BitWriter
+	{
+		unsigned char* out;
+		int bit;
+
+		void Write(std::uint32_t value, int nBits)
+		{
+			for (int i = 0; i < nBits; i++, bit++)
+			{
+				if ((value >> i) & 1)
+					out[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+			}
+		}
+	};
+
+	///////////////////////////////////////////////////
+	//	QuantizeBC7(const float*, int*, int&)
+	//
+	//	Endpoint channels of mode 6 are 7 bits plus a p bit shared by the
+	//	endpoint's four channels; pick the p bit that lands closer
+	///////////////////////////////////////////////////
+	void QuantizeBC7(const float endpoint[4], int quantized[4], int& pBit)
+	{
+		float bestError = -1.0f;
+		for (int p = 0; p < 2; p++)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				float value = std::min(std::max(endpoint[c], 0.0f), 255.0f);
+				candidate[c] = std::min(std::max(int(std::lround((value - float(p)) / 2.0f)), 0), 127);
+				float decoded = float((candidate[c] << 1) | p);
+				error += (decoded - value) * (decoded - value);
+			}
+			if (bestError < 0.0f || error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				std::copy(candidate, candidate + 4, quantized);
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////
+	//	EncodeBC7(const Block&, unsigned char*)
+	//
+	//	16 byte mode 6 block. Its weights are symmetric, so when the first
+	//	texel's index has the high bit set (the format stores it in 3 bits)
+	//	swapping the endpoints and mirroring every index fixes it.
+	///////////////////////////////////////////////////
+	void EncodeBC7(const Block& block, unsigned char* out)
+	{
+		float e0[4], e1[4];
+		Endpoints(block, 4, e0, e1);
+
+		int q[2][4];
+		int p[2];
+		QuantizeBC7(e0, q[0], p[0]);
+		QuantizeBC7(e1, q[1], p[1]);
+		for (int c = 0; c < 4; c++)
+		{
+			e0[c] = float((q[0][c] << 1) | p[0]);
+			e1[c] = float((q[1][c] << 1) | p[1]);
+		}
+
+		int indices[nTexels];
+		Project(block, 4, e0, e1, 15, indices);
+		if (indices[0] >= 8)
+		{
+			std::swap(q[0], q[1]);
+			std::swap(p[0], p[1]);
+			for (int t = 0; t < nTexels; t++)
+				indices[t] = 15 - indices[t];
+		}
+
+		std::memset(out, 0, 16);
+		BitWriter bits{ out, 0 };
+		bits.Write(1 << 6, 7);		// mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			bits.Write(std::uint32_t(q[0][c]), 7);
+			bits.Write(std::uint32_t(q[1][c]), 7);
+		}
+		bits.Write(std::uint32_t(p[0]), 1);
+		bits.Write(std::uint32_t(p[1]), 1);
+		bits.Write(std::uint32_t(indices[0]), 3);
+		for (int t = 1; t < nTexels; t++)
+			bits.Write(std::uint32_t(indices[t]), 4);
+	}
+}
+
+std::size_t BlockCompress::BlockBytes(Format format)
+{
+	return format == Format::BC1 ? 8 : 16;
+}
+
+std::size_t BlockCompress::LevelBytes(Format format, int width, int height)
+{
+	std::size_t blocksWide = std::size_t(width + blockSize - 1) / blockSize;
+	std::size_t blocksHigh = std::size_t(height + blockSize - 1) / blockSize;
+	return blocksWide * blocksHigh * BlockBytes(format);
+}
+
+GLenum BlockCompress::InternalFormat(Format format, bool srgb)
+{
+	switch (format)
+	{
+	case Format::BC1:
+		return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case Format::BC3:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case Format::BC7:
+	default:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Supported(Format)
+//
+//	BC1 and BC3 (S3TC) are an extension every desktop driver exposes; BC7
+//	(BPTC) is core since GL 4.2
+///////////////////////////////////////////////////
+bool BlockCompress::Supported(Format format)
+{
+	if (format == Format::BC7)
+		return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+	return GLEW_EXT_texture_compression_s3tc;
+}
+
+bool BlockCompress::HasAlpha(const unsigned char* pixels, int width, int height, int channels)
+{
+	if (channels != 2 && channels != 4)
+		return false;
+
+	std::size_t nPixels = std::size_t(width) * height;
+	for (std::size_t i = 0; i < nPixels; i++)
+	{
+		if (pixels[i * channels + channels - 1] != 255)
+			return true;
+	}
+	return false;
+}
+
+void BlockCompress::Encode(Format format, const unsigned char* pixels, int width, int height, int channels,
+	int firstBlockRow, int nBlockRows, unsigned char* blocks)
+{
+	int blocksWide = (width + blockSize - 1) / blockSize;
+	std::size_t blockBytes = BlockBytes(format);
+
+	Block block;
+	for (int by = firstBlockRow; by < firstBlockRow + nBlockRows; by++)
+	{
+		for (int bx = 0; bx < blocksWide; bx++)
+		{
+			Gather(pixels, width, height, channels, bx, by, block);
+			switch (format)
+			{
+			case Format::BC1:
+				EncodeColor(block, blocks);
+				break;
+			case Format::BC3:
+				EncodeAlpha(block, blocks);
+				EncodeColor(block, blocks + 8);
+				break;
+			case Format::BC7:
+				EncodeBC7(block, blocks);
+				break;
+			}
+			blocks += blockBytes;
+		}
+	}
+}
+
+void BlockCompress::Encode(Format format, const unsigned char* pixels, int width, int height, int channels,
+	unsigned char* blocks)
+{
+	Encode(format, pixels, width, height, channels, 0, (height + blockSize - 1) / blockSize, blocks);
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompress.h
+// ========
+// CPU encoder for the BC1, BC3 and BC7 block compressed texture formats,
+// which the GPU samples directly at 4 or 8 bits per texel
+//
+// Every 4x4 block is encoded on its own, so callers may split an image
+// across threads by rows of blocks. Endpoints come from the block's
+// bounding box along its principal diagonal; texel indices are found by
+// projecting onto the endpoint line, 4 texels at a time with SSE where the
+// compiler targets it. BC7 blocks use mode 6 (one subset, RGBA endpoints
+// with 16 weights), which suits smooth photographic content.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <cstddef>
+
+namespace BlockCompress
+{
+	enum class Format
+	{
+		BC1,	// RGB, 8 bytes per block
+		BC3,	// RGB with separate alpha, 16 bytes per block
+		BC7		// RGBA, 16 bytes per block
+	};
+
+	const int blockSize = 4;	// Texels along each side of a block
+
+	std::size_t BlockBytes(Format format);
+
+	// Bytes of one level of width x height texels, partial blocks rounded up
+	std::size_t LevelBytes(Format format, int width, int height);
+
+	GLenum InternalFormat(Format format, bool srgb = false);
+
+	// Whether the context can sample format; call after glewInit()
+	bool Supported(Format format);
+
+	// Whether any texel of an 8 bit image has alpha below 255; 2 and 4
+	// channel images have alpha last
+	bool HasAlpha(const unsigned char* pixels, int width, int height, int channels);
+
+	// Encode rows [firstBlockRow, firstBlockRow + nBlockRows) of blocks of an
+	// 8 bit image of 1 to 4 channels. 1 and 2 channel images are gray and
+	// gray with alpha, expanded to RGB and RGBA.
+	// Blocks past the right or bottom edge repeat the edge texels. blocks
+	// receives the rows of blocks, tightly packed.
+	void Encode(Format format, const unsigned char* pixels, int width, int height, int channels,
+		int firstBlockRow, int nBlockRows, unsigned char* blocks);
+
+	// Encode a whole level into LevelBytes(format, width, height) bytes
+	void Encode(Format format, const unsigned char* pixels, int width, int height, int channels,
+		unsigned char* blocks);
+}
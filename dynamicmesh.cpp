@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicmesh.cpp
+// ========
+// geometry rewritten every frame (animated or procedurally updated meshes)
+// streamed through persistently mapped vertex and index buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dynamicmesh.h"
+#include "gpuresources.h"
+#include "primitives.h"
+#include "vertexformat.h"
+
+#include <iostream>
+
+namespace
+{
+	// Slice of a blocking fence wait; waits repeat until the fence signals
+	const GLuint64 fenceTimeout = 1000000000;	// Nanoseconds
+}
+
+DynamicMesh::DynamicMesh()
+	: vao(0), vbos{ 0, 0 }, maxVertices(0), maxIndices(0), mappedVerts(nullptr), mappedIndices(nullptr),
+	fences{}, region(0), drawRegion(0), nVertices(0), nIndices(0), nStalls(0)
+{
+}
+
+///////////////////////////////////////////////////
+//	Create(GLuint, GLuint)
+//
+//	maxVertices: most vertices a frame's mesh may have
+//	maxIndices: most GL_TRIANGLES indices a frame's mesh may have
+//
+//	Create the VAO and nRegions times the storage in immutable buffers,
+//	mapped once for the lifetime of the mesh
+///////////////////////////////////////////////////
+bool DynamicMesh::Create(GLuint maxVertices, GLuint maxIndices)
+{
+	Destroy();
+	this->maxVertices = maxVertices;
+	this->maxIndices = maxIndices;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr vertsSize = VertexFormat::floatStride * GLsizeiptr(maxVertices) * nRegions;
+	GLsizeiptr indicesSize = GLsizeiptr(sizeof(GLuint)) * maxIndices * nRegions;
+
+	GpuResources::GenVertexArrays(1, &vao, "dynamic mesh");
+	glBindVertexArray(vao);
+	GpuResources::GenBuffers(2, vbos, "dynamic mesh");
+	GpuResources::SetSize(GpuResources::Kind::Buffer, vbos[0], std::size_t(vertsSize));
+	GpuResources::SetSize(GpuResources::Kind::Buffer, vbos[1], std::size_t(indicesSize));
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbos[0]);
+	glBufferStorage(GL_ARRAY_BUFFER, vertsSize, nullptr, flags);
+	mappedVerts = static_cast<GLfloat*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, vertsSize, flags));
+	glBindVertexBuffer(0, vbos[0], 0, VertexFormat::floatStride);
+	VertexFormat::SetupFloatFormat(0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbos[1]);
+	glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indicesSize, nullptr, flags);
+	mappedIndices = static_cast<GLuint*>(glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indicesSize, flags));
+
+	glBindVertexArray(0);
+
+	if (!mappedVerts || !mappedIndices)
+	{
+		std::cout << "Failed to map dynamic mesh buffers" << std::endl;
+		Destroy();
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Wait for the GPU to finish with every region, then free the buffers
+///////////////////////////////////////////////////
+void DynamicMesh::Destroy()
+{
+	for (GLuint r = 0; r < nRegions; r++)
+	{
+		if (fences[r])
+		{
+			glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+			glDeleteSync(fences[r]);
+			fences[r] = 0;
+		}
+	}
+
+	if (vao)
+	{
+		// deleting a buffer unmaps it
+		GpuResources::DeleteVertexArrays(1, &vao);
+		GpuResources::DeleteBuffers(2, vbos);
+	}
+	vao = 0;
+	vbos[0] = vbos[1] = 0;
+	mappedVerts = nullptr;
+	mappedIndices = nullptr;
+	region = drawRegion = 0;
+	nVertices = nIndices = 0;
+}
+
+///////////////////////////////////////////////////
+//	Begin()
+//
+//	Fence the region drawn so far, then hand out the next region that is
+//	not being drawn, once the GPU has finished reading it
+///////////////////////////////////////////////////
+MeshBuilder DynamicMesh::Begin()
+{
+	// the fence follows every draw submitted since the last Begin(), the
+	// only ones that may have read drawRegion
+	if (nVertices > 0)
+	{
+		if (fences[drawRegion])
+			glDeleteSync(fences[drawRegion]);
+		fences[drawRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	region = (region + 1) % nRegions;
+	if (region == drawRegion)
+		region = (region + 1) % nRegions;
+	UWaitForRegion(region);
+
+	return MeshBuilder(mappedVerts + std::size_t(region) * maxVertices * Primitives::floatsPerElement, maxVertices,
+		mappedIndices + std::size_t(region) * maxIndices, maxIndices);
+}
+
+///////////////////////////////////////////////////
+//	End(const MeshBuilder&)
+//
+//	builder: the builder returned by the last Begin(), written to
+//
+//	Draw the new mesh from here on. The buffers are coherently mapped, so
+//	no flush is needed.
+///////////////////////////////////////////////////
+void DynamicMesh::End(const MeshBuilder& builder)
+{
+	if (builder.Dropped())
+	{
+		std::cout << "WARNING: Dynamic mesh exceeds " << maxVertices << " vertices or " << maxIndices
+			<< " indices, keeping the previous frame" << std::endl;
+		return;
+	}
+
+	drawRegion = region;
+	nVertices = builder.VertexCount();
+	nIndices = builder.IndexCount();
+}
+
+///////////////////////////////////////////////////
+//	Draw(GLsizei)
+//
+//	instanceCount: instances drawn, gl_InstanceID counting from 0
+///////////////////////////////////////////////////
+void DynamicMesh::Draw(GLsizei instanceCount) const
+{
+	if (nIndices == 0)
+		return;
+
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, GLsizei(nIndices), GL_UNSIGNED_INT,
+		(void*)(GLintptr(sizeof(GLuint)) * drawRegion * maxIndices), instanceCount, GLint(drawRegion * maxVertices));
+}
+
+void DynamicMesh::UWaitForRegion(GLuint index)
+{
+	GLsync fence = fences[index];
+	if (!fence)
+		return;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		nStalls++;
+		do
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+		while (result == GL_TIMEOUT_EXPIRED);
+	}
+	if (result == GL_WAIT_FAILED)
+		std::cout << "WARNING: Dynamic mesh fence wait failed" << std::endl;
+
+	glDeleteSync(fence);
+	fences[index] = 0;
+}
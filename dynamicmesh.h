@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicmesh.h
+// ========
+// geometry rewritten every frame (animated or procedurally updated meshes)
+// streamed through persistently mapped vertex and index buffers
+//
+// The buffers are split into nRegions regions of maxVertices / maxIndices
+// each. Every Begin() moves on to the next region, waiting on the fence put
+// behind the last draws that read it, so the CPU writes one region while the
+// GPU still reads the others.
+//
+//	// once, sized to exactly the torus, since MarkFull() claims all of it
+//	Primitives::MeshSize size = Primitives::TorusSize(main.segments, tube.segments);
+//	wave.Create(size.nVertices, size.nIndices);
+//
+//	// every frame
+//	MeshBuilder builder = wave.Begin();
+//	Primitives::Torus(1.0f, 0.1f + 0.05f * std::sin(time), main, tube, builder.Vertices(), builder.Indices());
+//	builder.MarkFull();
+//	wave.End(builder);
+//	glBindVertexArray(wave.vao);
+//	wave.Draw();
+//
+// Generators that write fewer than the reserved counts go through
+// MeshBuilder::Vertex() / Triangle() instead, which record what was written.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "meshbuilder.h"
+
+class DynamicMesh
+{
+public:
+	// One region being written, one queued, one being read
+	static const GLuint nRegions = 3;
+
+	DynamicMesh();
+
+	// Allocate and map the buffers for meshes of up to maxVertices
+	// vertices and maxIndices indices. Vertices are in the float layout,
+	// so shaders drawing them must leave ubOctNormals off.
+	bool Create(GLuint maxVertices, GLuint maxIndices);
+	void Destroy();
+
+	// Storage for this frame's mesh, once the GPU is done with it. Write
+	// through the builder, then pass it to End().
+	MeshBuilder Begin();
+
+	// Take the vertex and index counts written into the builder from
+	// Begin(). If it dropped writes the previous mesh stays drawn.
+	void End(const MeshBuilder& builder);
+
+	// Draw the mesh given to the last End() with vao bound
+	void Draw(GLsizei instanceCount = 1) const;
+
+	// Begin() calls that had to wait for the GPU
+	GLuint Stalls() const { return nStalls; }
+
+	GLuint vao;			// Handle for the vertex array object
+	GLuint vbos[2];		// Handles for the vertex and index buffer objects
+
+private:
+	DynamicMesh(const DynamicMesh&) = delete;
+	DynamicMesh& operator=(const DynamicMesh&) = delete;
+
+	void UWaitForRegion(GLuint index);
+
+	GLuint maxVertices;
+	GLuint maxIndices;
+	GLfloat* mappedVerts;	// Persistent mappings of the whole buffers
+	GLuint* mappedIndices;
+	GLsync fences[nRegions];	// Behind the last draws reading each region
+	GLuint region;			// Region handed out by the last Begin()
+	GLuint drawRegion;		// Region holding the mesh drawn
+	GLuint nVertices;		// Counts of the mesh drawn
+	GLuint nIndices;
+	GLuint nStalls;
+};
@@ -0,0 +1,275 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresources.cpp
+// ========
+// accounting of GL objects (buffers, textures, samplers, vertex arrays,
+// shaders and programs) and of large host allocations, with per-category
+// totals and a leak report at shutdown
+///////////////////////////////////////////////////////////////////////////////
+
+#include "gpuresources.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	using GpuResources::Kind;
+
+	const std::size_t nKinds = std::size_t(Kind::Count);
+	const char* const kindNames[nKinds] = { "buffer", "texture", "sampler", "vertex array", "shader", "program", "host allocation" };
+
+	struct Record
+	{
+		std::string label;
+		std::size_t bytes;
+	};
+
+	// Everything live, guarded by mutex; pool jobs may track host memory
+	std::mutex mutex;
+	std::unordered_map<std::uintptr_t, Record> records[nKinds];
+	GpuResources::Usage usage[nKinds];
+	std::size_t peakGpuBytes = 0;
+
+	std::size_t GpuBytes()
+	{
+		std::size_t total = 0;
+		for (std::size_t k = 0; k < nKinds; k++)
+		{
+			if (Kind(k) != Kind::Host)
+				total += usage[k].bytes;
+		}
+		return total;
+	}
+
+	std::string FormatBytes(std::size_t bytes)
+	{
+		std::ostringstream text;
+		if (bytes < 1024)
+			text << bytes << " B";
+		else if (bytes < 1024 * 1024)
+			text << std::fixed << std::setprecision(1) << double(bytes) / 1024.0 << " KB";
+		else
+			text << std::fixed << std::setprecision(1) << double(bytes) / (1024.0 * 1024.0) << " MB";
+		return text.str();
+	}
+
+	void GenNames(Kind kind, GLsizei n, const GLuint* names, const char* label)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (names[i])
+				GpuResources::Track(kind, names[i], label);
+		}
+	}
+
+	void DeleteNames(Kind kind, GLsizei n, const GLuint* names)
+	{
+		// GL ignores name 0, so do we
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (names[i])
+				GpuResources::Untrack(kind, names[i]);
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	Track(Kind, std::uintptr_t, const char*, std::size_t)
+//
+//	id: GL name, or the address for Kind::Host
+//	label: what the object holds, shown in the reports
+//
+//	Tracking an id again replaces its record
+///////////////////////////////////////////////////
+void GpuResources::Track(Kind kind, std::uintptr_t id, const char* label, std::size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::size_t k = std::size_t(kind);
+
+	auto inserted = records[k].insert({ id, Record{ label ? label : "", bytes } });
+	if (inserted.second)
+	{
+		usage[k].count++;
+	}
+	else
+	{
+		usage[k].bytes -= inserted.first->second.bytes;
+		inserted.first->second = Record{ label ? label : "", bytes };
+	}
+	usage[k].bytes += bytes;
+	peakGpuBytes = std::max(peakGpuBytes, GpuBytes());
+}
+
+void GpuResources::Untrack(Kind kind, std::uintptr_t id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::size_t k = std::size_t(kind);
+
+	auto found = records[k].find(id);
+	if (found == records[k].end())
+	{
+		std::cout << "WARNING: Releasing untracked " << kindNames[k] << " " << id << std::endl;
+		return;
+	}
+
+	usage[k].count--;
+	usage[k].bytes -= found->second.bytes;
+	records[k].erase(found);
+}
+
+void GpuResources::SetSize(Kind kind, std::uintptr_t id, std::size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::size_t k = std::size_t(kind);
+
+	auto found = records[k].find(id);
+	if (found == records[k].end())
+	{
+		std::cout << "WARNING: Sizing untracked " << kindNames[k] << " " << id << std::endl;
+		return;
+	}
+
+	usage[k].bytes += bytes;
+	usage[k].bytes -= found->second.bytes;
+	found->second.bytes = bytes;
+	peakGpuBytes = std::max(peakGpuBytes, GpuBytes());
+}
+
+void GpuResources::GenBuffers(GLsizei n, GLuint* names, const char* label)
+{
+	glGenBuffers(n, names);
+	GenNames(Kind::Buffer, n, names, label);
+}
+
+void GpuResources::DeleteBuffers(GLsizei n, const GLuint* names)
+{
+	DeleteNames(Kind::Buffer, n, names);
+	glDeleteBuffers(n, names);
+}
+
+void GpuResources::GenTextures(GLsizei n, GLuint* names, const char* label)
+{
+	glGenTextures(n, names);
+	GenNames(Kind::Texture, n, names, label);
+}
+
+void GpuResources::DeleteTextures(GLsizei n, const GLuint* names)
+{
+	DeleteNames(Kind::Texture, n, names);
+	glDeleteTextures(n, names);
+}
+
+void GpuResources::GenSamplers(GLsizei n, GLuint* names, const char* label)
+{
+	glGenSamplers(n, names);
+	GenNames(Kind::Sampler, n, names, label);
+}
+
+void GpuResources::DeleteSamplers(GLsizei n, const GLuint* names)
+{
+	DeleteNames(Kind::Sampler, n, names);
+	glDeleteSamplers(n, names);
+}
+
+void GpuResources::GenVertexArrays(GLsizei n, GLuint* names, const char* label)
+{
+	glGenVertexArrays(n, names);
+	GenNames(Kind::VertexArray, n, names, label);
+}
+
+void GpuResources::DeleteVertexArrays(GLsizei n, const GLuint* names)
+{
+	DeleteNames(Kind::VertexArray, n, names);
+	glDeleteVertexArrays(n, names);
+}
+
+GLuint GpuResources::CreateShader(GLenum type, const char* label)
+{
+	GLuint shader = glCreateShader(type);
+	GenNames(Kind::Shader, 1, &shader, label);
+	return shader;
+}
+
+void GpuResources::DeleteShader(GLuint shader)
+{
+	DeleteNames(Kind::Shader, 1, &shader);
+	glDeleteShader(shader);
+}
+
+GLuint GpuResources::CreateProgram(const char* label)
+{
+	GLuint program = glCreateProgram();
+	GenNames(Kind::Program, 1, &program, label);
+	return program;
+}
+
+void GpuResources::DeleteProgram(GLuint program)
+{
+	DeleteNames(Kind::Program, 1, &program);
+	glDeleteProgram(program);
+}
+
+///////////////////////////////////////////////////
+//	TextureBytes(GLsizei, GLsizei, std::size_t, bool)
+//
+//	Sum the levels down to 1x1, each dimension halving and rounding down
+///////////////////////////////////////////////////
+std::size_t GpuResources::TextureBytes(GLsizei width, GLsizei height, std::size_t bytesPerTexel, bool mipmapped)
+{
+	std::size_t bytes = 0;
+	for (;;)
+	{
+		bytes += std::size_t(width) * std::size_t(height) * bytesPerTexel;
+		if (!mipmapped || (width <= 1 && height <= 1))
+			return bytes;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+}
+
+GpuResources::Usage GpuResources::CurrentUsage(Kind kind)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return usage[std::size_t(kind)];
+}
+
+void GpuResources::ReportUsage()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::cout << "INFO: GPU memory " << FormatBytes(GpuBytes()) << ", peak " << FormatBytes(peakGpuBytes) << std::endl;
+	for (std::size_t k = 0; k < nKinds; k++)
+	{
+		if (usage[k].count == 0)
+			continue;
+		std::cout << "INFO:   " << usage[k].count << " x " << kindNames[k] << ", " << FormatBytes(usage[k].bytes) << std::endl;
+	}
+}
+
+///////////////////////////////////////////////////
+//	ReportLeaks()
+//
+//	Print one line per object never released, with its label and size
+///////////////////////////////////////////////////
+std::size_t GpuResources::ReportLeaks()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::size_t nLeaks = 0;
+	for (std::size_t k = 0; k < nKinds; k++)
+	{
+		for (const auto& entry : records[k])
+		{
+			std::cout << "WARNING: Leaked " << kindNames[k] << " " << entry.first << " (" << entry.second.label << "), "
+				<< FormatBytes(entry.second.bytes) << std::endl;
+			nLeaks++;
+		}
+	}
+
+	if (nLeaks == 0)
+		std::cout << "INFO: No resources leaked, GPU peak " << FormatBytes(peakGpuBytes) << std::endl;
+	return nLeaks;
+}
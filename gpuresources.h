@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuresources.h
+// ========
+// accounting of GL objects (buffers, textures, samplers, vertex arrays,
+// shaders and programs) and of large host allocations, with per-category
+// totals and a leak report at shutdown
+//
+// Create and delete GL objects through the wrappers below instead of the
+// raw glGen* / glDelete* calls, and record the bytes behind each one with
+// SetSize() once its storage is allocated. Sizes are what was requested
+// from GL, not what the driver actually reserves.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GpuResources
+{
+	enum class Kind
+	{
+		Buffer,
+		Texture,
+		Sampler,
+		VertexArray,
+		Shader,
+		Program,
+		Host,		// CPU memory, keyed by address
+		Count
+	};
+
+	// Objects of one kind alive right now, and the bytes recorded for them
+	struct Usage
+	{
+		std::size_t count = 0;
+		std::size_t bytes = 0;
+	};
+
+	// Record an object created outside the wrappers, or host memory. id is
+	// the GL name, or the address for Kind::Host. Safe on any thread.
+	void Track(Kind kind, std::uintptr_t id, const char* label, std::size_t bytes = 0);
+	void Untrack(Kind kind, std::uintptr_t id);
+
+	// Replace the bytes recorded for a tracked object
+	void SetSize(Kind kind, std::uintptr_t id, std::size_t bytes);
+
+	void GenBuffers(GLsizei n, GLuint* names, const char* label);
+	void DeleteBuffers(GLsizei n, const GLuint* names);
+	void GenTextures(GLsizei n, GLuint* names, const char* label);
+	void DeleteTextures(GLsizei n, const GLuint* names);
+	void GenSamplers(GLsizei n, GLuint* names, const char* label);
+	void DeleteSamplers(GLsizei n, const GLuint* names);
+	void GenVertexArrays(GLsizei n, GLuint* names, const char* label);
+	void DeleteVertexArrays(GLsizei n, const GLuint* names);
+	GLuint CreateShader(GLenum type, const char* label);
+	void DeleteShader(GLuint shader);
+	GLuint CreateProgram(const char* label);
+	void DeleteProgram(GLuint program);
+
+	// Bytes of a 2D texture, with its full mip chain when mipmapped
+	std::size_t TextureBytes(GLsizei width, GLsizei height, std::size_t bytesPerTexel, bool mipmapped);
+
+	Usage CurrentUsage(Kind kind);
+
+	// Print the count and bytes of every kind, and the peak total GPU bytes
+	void ReportUsage();
+
+	// Print every object still tracked; return how many there are. Call
+	// once everything should have been released.
+	std::size_t ReportLeaks();
+}
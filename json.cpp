@@ -0,0 +1,230 @@
+///////////////////////////////////////////////////////////////////////////////
+// json.cpp
+// ========
+// minimal read-only JSON document for asset headers (glTF)
+///////////////////////////////////////////////////////////////////////////////
+
+#include "json.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace
+{
+	// Deeper documents are rejected rather than risking the stack
+	const int maxDepth = 256;
+}
+
+struct Json::Document::Parser
+{
+	Document& document;
+	const char* p;
+	const char* end;
+	std::vector<std::size_t> pending;	// Children of the containers being parsed
+
+	void SkipSpace()
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+			p++;
+	}
+
+	bool Literal(const char* word)
+	{
+		std::size_t length = std::strlen(word);
+		if (std::size_t(end - p) < length || std::memcmp(p, word, length) != 0)
+			return false;
+		p += length;
+		return true;
+	}
+
+	// p is on the opening quote; leaves it after the closing one
+	bool ParseString(std::string_view& out)
+	{
+		const char* begin = ++p;
+		while (p < end && *p != '"')
+		{
+			if (*p == '\\')
+				p++;
+			p++;
+		}
+		if (p >= end)
+			return false;
+		out = std::string_view(begin, std::size_t(p - begin));
+		p++;
+		return true;
+	}
+
+	bool ParseValue(std::size_t index, int depth)
+	{
+		if (depth > maxDepth)
+			return false;
+
+		SkipSpace();
+		if (p >= end)
+			return false;
+
+		Value& value = document.values[index];
+		switch (*p)
+		{
+		case '{':
+		case '[':
+			return ParseContainer(index, depth);
+		case '"':
+			value.type = Type::String;
+			return ParseString(value.string);
+		case 't':
+			value.type = Type::Bool;
+			value.boolean = true;
+			return Literal("true");
+		case 'f':
+			value.type = Type::Bool;
+			return Literal("false");
+		case 'n':
+			return Literal("null");
+		default:
+		{
+			value.type = Type::Number;
+			std::from_chars_result result = std::from_chars(p, end, value.number);
+			if (result.ec != std::errc() || result.ptr == p)
+				return false;
+			p = result.ptr;
+			return true;
+		}
+		}
+	}
+
+	bool ParseContainer(std::size_t index, int depth)
+	{
+		bool object = *p == '{';
+		char close = object ? '}' : ']';
+		document.values[index].type = object ? Type::Object : Type::Array;
+		p++;
+
+		std::size_t start = pending.size();
+		SkipSpace();
+		if (p < end && *p == close)
+			p++;
+		else
+		{
+			for (;;)
+			{
+				std::size_t child = document.values.size();
+				document.values.emplace_back();
+				pending.push_back(child);
+
+				if (object)
+				{
+					SkipSpace();
+					std::string_view key;
+					if (p >= end || *p != '"' || !ParseString(key))
+						return false;
+					document.values[child].key = key;
+					SkipSpace();
+					if (p >= end || *p++ != ':')
+						return false;
+				}
+
+				if (!ParseValue(child, depth + 1))
+					return false;
+
+				SkipSpace();
+				if (p >= end)
+					return false;
+				if (*p == ',')
+				{
+					p++;
+					continue;
+				}
+				if (*p++ != close)
+					return false;
+				break;
+			}
+		}
+
+		// the children of one container end up next to each other, after
+		// those of the containers nested in it
+		Value& value = document.values[index];
+		value.firstChild = document.children.size();
+		value.nChildren = pending.size() - start;
+		document.children.insert(document.children.end(), pending.begin() + start, pending.end());
+		pending.resize(start);
+		return true;
+	}
+};
+
+///////////////////////////////////////////////////
+//	Parse(const char*, std::size_t)
+//
+//	text: JSON text, not necessarily null terminated
+///////////////////////////////////////////////////
+bool Json::Document::Parse(const char* text, std::size_t size)
+{
+	values.clear();
+	children.clear();
+	error.clear();
+
+	Parser parser = { *this, text, text + size, {} };
+	values.emplace_back();
+	bool parsed = parser.ParseValue(root, 0);
+	parser.SkipSpace();
+	if (!parsed || parser.p != parser.end)
+	{
+		error = "JSON syntax error at offset " + std::to_string(parser.p - text);
+		values.clear();
+		children.clear();
+		return false;
+	}
+	return true;
+}
+
+std::size_t Json::Document::Size(std::size_t value) const
+{
+	const Value* container = Get(value);
+	return container ? container->nChildren : 0;
+}
+
+std::size_t Json::Document::Element(std::size_t array, std::size_t i) const
+{
+	const Value* container = Get(array);
+	if (!container || container->type != Type::Array || i >= container->nChildren)
+		return npos;
+	return children[container->firstChild + i];
+}
+
+///////////////////////////////////////////////////
+//	Member(std::size_t, std::string_view)
+//
+//	Linear search; asset headers have few members per object
+///////////////////////////////////////////////////
+std::size_t Json::Document::Member(std::size_t object, std::string_view key) const
+{
+	const Value* container = Get(object);
+	if (!container || container->type != Type::Object)
+		return npos;
+
+	for (std::size_t i = 0; i < container->nChildren; i++)
+	{
+		std::size_t child = children[container->firstChild + i];
+		if (values[child].key == key)
+			return child;
+	}
+	return npos;
+}
+
+double Json::Document::Number(std::size_t value, double fallback) const
+{
+	const Value* number = Get(value);
+	return number && number->type == Type::Number ? number->number : fallback;
+}
+
+std::string_view Json::Document::String(std::size_t value, std::string_view fallback) const
+{
+	const Value* string = Get(value);
+	return string && string->type == Type::String ? string->string : fallback;
+}
+
+bool Json::Document::Bool(std::size_t value, bool fallback) const
+{
+	const Value* boolean = Get(value);
+	return boolean && boolean->type == Type::Bool ? boolean->boolean : fallback;
+}
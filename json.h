@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// json.h
+// ========
+// minimal read-only JSON document for asset headers (glTF)
+//
+// Parsing builds a flat array of values over the caller's text without
+// copying it: strings and keys are views into the text, with escapes left
+// as written. The text must outlive the Document.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Json
+{
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	struct Value
+	{
+		Type type = Type::Null;
+		std::string_view key;		// Member name when the parent is an object
+		std::string_view string;	// String contents, escapes not decoded
+		double number = 0.0;
+		bool boolean = false;
+		std::size_t firstChild = 0;	// Array elements or object members, in children
+		std::size_t nChildren = 0;
+	};
+
+	class Document
+	{
+	public:
+		// Replace the document with text; false with Error() set on a syntax
+		// error
+		bool Parse(const char* text, std::size_t size);
+
+		const std::string& Error() const { return error; }
+
+		// Values are referred to by index; the root is 0 and npos means
+		// "not there". Every lookup accepts npos and returns npos or the
+		// fallback, so chains need no checks in between.
+		static const std::size_t npos = ~std::size_t(0);
+		static const std::size_t root = 0;
+
+		const Value* Get(std::size_t value) const { return value < values.size() ? &values[value] : nullptr; }
+		Type TypeOf(std::size_t value) const { return value < values.size() ? values[value].type : Type::Null; }
+		std::size_t Size(std::size_t value) const;			// Elements of an array, members of an object
+		std::size_t Element(std::size_t array, std::size_t i) const;
+		std::size_t Member(std::size_t object, std::string_view key) const;
+
+		double Number(std::size_t value, double fallback) const;
+		std::string_view String(std::size_t value, std::string_view fallback = std::string_view()) const;
+		bool Bool(std::size_t value, bool fallback) const;
+
+	private:
+		struct Parser;
+
+		std::vector<Value> values;
+		std::vector<std::size_t> children;	// Child indices, each parent's run contiguous
+		std::string error;
+	};
+}
@@ -3,9 +3,6 @@
 #include <GL/glew.h>        // GLEW library
 #include <GLFW/glfw3.h>     // GLFW library
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>      // Image loading Utility functions
-
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -13,6 +10,10 @@
 
 #include <camera.h>
 #include <meshes.h>
+#include <material.h>
+#include <gpuresources.h>
+#include <samplers.h>
+#include <texturestreamer.h>
 
 using namespace std; // Uses the standard namespace
 
@@ -48,6 +49,8 @@ namespace
 	// Texture
 	GLuint gPlaneTextureId;
 	GLuint gPyramidTextureId;
+	// Streams the textures in, from the texture cache after the first run
+	TextureStreamer gTextureStreamer;
 	// Meshes object
 	Meshes meshes;
 
@@ -76,14 +79,27 @@ out vec2 vertexTextureCoordinate;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform bool ubOctNormals; // Normals arrive octahedral-encoded in xy (Meshes packed vertex layout)
+
+// Unfold an octahedral-encoded normal back onto the unit sphere
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
 
 void main()
 {
+	vec3 normal = ubOctNormals ? octDecode(vertexNormal.xy) : vertexNormal;
+
 	gl_Position = projection * view * model * vec4(vertexPosition, 1.0f); // Transforms vertices into clip coordinates
 
 	vertexFragmentPos = vec3(model * vec4(vertexPosition, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
 
-	vertexFragmentNormal = mat3(transpose(inverse(model))) * vertexNormal; // get normal vectors in world space only and exclude normal translation properties
+	vertexFragmentNormal = mat3(transpose(inverse(model))) * normal; // get normal vectors in world space only and exclude normal translation properties
 	vertexTextureCoordinate = textureCoordinate;
 }
 );
@@ -176,7 +192,6 @@ void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void URender();
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint &programId);
 void UDestroyShaderProgram(GLuint programId);
-bool UCreateTexture(const char* filename, GLuint &textureId);
 void UDestroyTexture(GLuint textureId);
 
 // main function. Entry point to the OpenGL program
@@ -192,20 +207,25 @@ int main(int argc, char* argv[])
 	if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId))
 		return EXIT_FAILURE;
 
-	// Load texture
-	const char * texFilename = "../../resources/textures/tiles.png";
-	if (!UCreateTexture(texFilename, gPlaneTextureId))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
-		return EXIT_FAILURE;
-	}
+	// Tell the vertex shader which normal encoding the meshes were stored with
+	glUniform1i(glGetUniformLocation(gProgramId, "ubOctNormals"), meshes.settings.packedVertices);
 
-	texFilename = "../../resources/textures/whitemarble.jpg";
-	if (!UCreateTexture(texFilename, gPyramidTextureId))
-	{
-		cout << "Failed to load texture " << texFilename << endl;
+	// Load textures; images are loaded with Y axis going down, but OpenGL's
+	// Y axis goes up, so they are flipped while decoding. The flipped texels
+	// and their mips are cached, so later runs skip decoding entirely. Gray
+	// images are expanded to RGBA like the rest.
+	if (!gTextureStreamer.Create())
+		return EXIT_FAILURE;
+	Textures::DecodeOptions decodeOptions;
+	decodeOptions.channels = 4;
+	decodeOptions.flipVertically = true;
+	gPlaneTextureId = gTextureStreamer.Load("../../resources/textures/tiles.png", decodeOptions);
+	gPyramidTextureId = gTextureStreamer.Load("../../resources/textures/whitemarble.jpg", decodeOptions);
+
+	// Wrapping and filtering come from the samplers each material binds:
+	// trilinear for the pyramid, anisotropic for the plane
+	if (!Samplers::Create())
 		return EXIT_FAILURE;
-	}
 
 	// bind textures on corresponding texture units
 	glActiveTexture(GL_TEXTURE0);
@@ -213,6 +233,8 @@ int main(int argc, char* argv[])
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, gPyramidTextureId);
 
+	GpuResources::ReportUsage();
+
 	// Sets the background color of the window to black (it will be implicitely used by glClear)
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -222,6 +244,7 @@ int main(int argc, char* argv[])
 
 	// render loop
 	// -----------
+	int exitCode = EXIT_SUCCESS;
 	while (!glfwWindowShouldClose(gWindow))
 	{
 		// per-frame timing
@@ -234,6 +257,14 @@ int main(int argc, char* argv[])
 		// -----
 		UProcessInput(gWindow);
 
+		// a texture that failed to load ends the program, as it would have
+		// before the first frame if loading did not stream
+		gTextureStreamer.Update();
+		if (gTextureStreamer.Failed(gPlaneTextureId) || gTextureStreamer.Failed(gPyramidTextureId))
+		{
+			exitCode = EXIT_FAILURE;
+			break;
+		}
 		URender();
 
 		glfwPollEvents();
@@ -243,10 +274,13 @@ int main(int argc, char* argv[])
 	meshes.DestroyMeshes();
 
 	UDestroyShaderProgram(gProgramId);
+	gTextureStreamer.Destroy();
 	UDestroyTexture(gPlaneTextureId);
 	UDestroyTexture(gPyramidTextureId);
+	Samplers::Destroy();
 
-	exit(EXIT_SUCCESS); // Terminates the program successfully
+	GpuResources::ReportLeaks();
+	exit(exitCode); // Terminates the program
 }
 
 
@@ -428,8 +462,8 @@ void URender()
 	ubHasTextureVal = true;
 	glUniform1i(uHasTextureLoc, ubHasTextureVal);
 
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPlaneMesh.vao);
+	// Activate the shared VAO that holds every mesh
+	glBindVertexArray(meshes.vao);
 
 	// 1. Scales the object by 2
 	scale = glm::scale(glm::vec3(20.0f, 1.0f, 10.0f));
@@ -449,10 +483,8 @@ void URender()
 	// We set the texture as texture unit 0
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-	glDrawElements(GL_TRIANGLES, meshes.gPlaneMesh.nIndices, GL_UNSIGNED_INT, (void*)0);
-
-	// Activate the VBOs contained within the mesh's VAO
-	glBindVertexArray(meshes.gPyramid4Mesh.vao);
+	Materials::Apply(Materials::twoSided, model);
+	meshes.Draw(Meshes::PlaneMesh);
 
 	// 1. Scales the object
 	scale = glm::scale(glm::vec3(4.0f, 4.0f, 4.0f));
@@ -468,7 +500,8 @@ void URender()
 	// We set the texture as texture unit 0
 	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 1);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, meshes.gPyramid4Mesh.nVertices);
+	Materials::Apply(Materials::solid, model);
+	meshes.Draw(Meshes::Pyramid4Mesh);
 
 	glBindVertexArray(0);
 
@@ -490,11 +523,11 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	char infoLog[512];
 
 	// Create a Shader program object.
-	programId = glCreateProgram();
+	programId = GpuResources::CreateProgram("surface shader");
 
 	// Create the vertex and fragment shader objects
-	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+	GLuint vertexShaderId = GpuResources::CreateShader(GL_VERTEX_SHADER, "surface vertex shader");
+	GLuint fragmentShaderId = GpuResources::CreateShader(GL_FRAGMENT_SHADER, "surface fragment shader");
 
 	// Retrive the shader source
 	glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
@@ -528,6 +561,10 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 	glAttachShader(programId, fragmentShaderId);
 
 	glLinkProgram(programId);   // links the shader program
+
+	// the program keeps what it needs; the shaders go once it is deleted
+	GpuResources::DeleteShader(vertexShaderId);
+	GpuResources::DeleteShader(fragmentShaderId);
 	// check for linking errors
 	glGetProgramiv(programId, GL_LINK_STATUS, &success);
 	if (!success)
@@ -546,72 +583,11 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 
 void UDestroyShaderProgram(GLuint programId)
 {
-	glDeleteProgram(programId);
-}
-
-// Images are loaded with Y axis going down, but OpenGL's Y axis goes up, so let's flip it
-void flipImageVertically(unsigned char *image, int width, int height, int channels)
-{
-	for (int j = 0; j < height / 2; ++j)
-	{
-		int index1 = j * width * channels;
-		int index2 = (height - 1 - j) * width * channels;
-
-		for (int i = width * channels; i > 0; --i)
-		{
-			unsigned char tmp = image[index1];
-			image[index1] = image[index2];
-			image[index2] = tmp;
-			++index1;
-			++index2;
-		}
-	}
-}
-
-/*Generate and load the texture*/
-bool UCreateTexture(const char* filename, GLuint &textureId)
-{
-	int width, height, channels;
-	unsigned char *image = stbi_load(filename, &width, &height, &channels, 0);
-	if (image)
-	{
-		flipImageVertically(image, width, height, channels);
-
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		if (channels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		else if (channels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			cout << "Not implemented to handle image with " << channels << " channels" << endl;
-			return false;
-		}
-
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		return true;
-	}
-
-	// Error loading the image
-	return false;
+	GpuResources::DeleteProgram(programId);
 }
 
-
 void UDestroyTexture(GLuint textureId)
 {
-	glGenTextures(1, &textureId);
+	GpuResources::DeleteTextures(1, &textureId);
 }
 
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.cpp
+// ========
+// read-only memory mapping of a whole file, used by the loaders that parse
+// or copy from file contents in place
+///////////////////////////////////////////////////////////////////////////////
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+	: data(nullptr), size(0), open(false), fileHandle(nullptr), mappingHandle(nullptr)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+///////////////////////////////////////////////////
+//	Open(const char*)
+//
+//	path: file to map
+//
+//	Map the whole file read-only, closing any previous mapping first
+///////////////////////////////////////////////////
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		Close();
+		return false;
+	}
+	size = std::size_t(fileSize.QuadPart);
+
+	// an empty file cannot be mapped
+	if (size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			Close();
+			return false;
+		}
+		mappingHandle = mapping;
+
+		data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!data)
+		{
+			Close();
+			return false;
+		}
+	}
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	size = std::size_t(fileStat.st_size);
+
+	// an empty file cannot be mapped; the mapping stays valid after the
+	// descriptor is closed
+	if (size > 0)
+	{
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED)
+		{
+			close(fd);
+			size = 0;
+			return false;
+		}
+		data = static_cast<const unsigned char*>(mapped);
+
+		// every loader touches the whole file, start reading it in now
+		madvise(mapped, size, MADV_WILLNEED);
+	}
+	close(fd);
+#endif
+
+	open = true;
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Close()
+//
+//	Unmap the file; safe to call when nothing is mapped
+///////////////////////////////////////////////////
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle)
+		CloseHandle(fileHandle);
+#else
+	if (data)
+		munmap(const_cast<unsigned char*>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+	open = false;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
@@ -0,0 +1,36 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ========
+// read-only memory mapping of a whole file, used by the loaders that parse
+// or copy from file contents in place
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Fails, leaving nothing mapped, when the file cannot be opened or
+	// mapped. An empty file opens with Data() null and Size() 0.
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return open; }
+	const unsigned char* Data() const { return data; }
+	std::size_t Size() const { return size; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const unsigned char* data;
+	std::size_t size;
+	bool open;
+	void* fileHandle;
+	void* mappingHandle;
+};
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// material.cpp
+// ========
+// per-surface render state applied before each draw
+///////////////////////////////////////////////////////////////////////////////
+
+#include "material.h"
+
+namespace
+{
+	// Last state set, starting from the GL defaults
+	bool gCullEnabled = false;
+	GLenum gCullFace = GL_BACK;
+	GLenum gFrontFace = GL_CCW;
+}
+
+///////////////////////////////////////////////////
+//	Apply(const Material&, const glm::mat4&)
+//
+//	material: state to set
+//	model: model matrix of the draw that follows
+///////////////////////////////////////////////////
+void Materials::Apply(const Material& material, const glm::mat4& model)
+{
+	Samplers::Bind(material.sampler);
+
+	bool cullEnabled = material.cullFace != GL_NONE;
+	if (cullEnabled != gCullEnabled)
+	{
+		if (cullEnabled)
+			glEnable(GL_CULL_FACE);
+		else
+			glDisable(GL_CULL_FACE);
+		gCullEnabled = cullEnabled;
+	}
+
+	if (!cullEnabled)
+		return;
+
+	if (material.cullFace != gCullFace)
+	{
+		glCullFace(material.cullFace);
+		gCullFace = material.cullFace;
+	}
+
+	// a negative scale turns counter-clockwise triangles clockwise on screen
+	GLenum frontFace = glm::determinant(glm::mat3(model)) < 0.0f ? GL_CW : GL_CCW;
+	if (frontFace != gFrontFace)
+	{
+		glFrontFace(frontFace);
+		gFrontFace = frontFace;
+	}
+}
@@ -0,0 +1,35 @@
+///////////////////////////////////////////////////////////////////////////////
+// material.h
+// ========
+// per-surface render state applied before each draw
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include "samplers.h"
+
+namespace Materials
+{
+	struct Material
+	{
+		GLenum cullFace;			// GL_BACK for closed solids, GL_NONE to draw both sides
+		Samplers::Preset sampler;	// How every texture of the draw is filtered
+	};
+
+	// Closed Meshes primitives, all wound counter-clockwise outward
+	const Material solid = { GL_BACK, Samplers::Preset::Trilinear };
+
+	// Open surfaces that can be seen from below, like the plane. Large
+	// planes are mostly seen at grazing angles, where only anisotropic
+	// filtering keeps them both sharp and free of aliasing.
+	const Material twoSided = { GL_NONE, Samplers::Preset::Anisotropic };
+
+	// Set the material's state for a draw with the given model matrix. A
+	// mirroring model matrix swaps the front face so that the back faces
+	// are still the ones culled. GL calls are skipped when nothing changes.
+	// Samplers::Create() must have been called.
+	void Apply(const Material& material, const glm::mat4& model);
+}
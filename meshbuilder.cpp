@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshbuilder.cpp
+// ========
+// write interleaved vertices and GL_TRIANGLES indices in place, into memory
+// reserved up front from a monotonic arena or supplied by the caller
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshbuilder.h"
+#include "primitives.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace
+{
+	// Smallest overflow block, so a run of small requests does not make one
+	// block each
+	const std::size_t minOverflowBlock = 4096;
+
+	// Offset of the first multiple of alignment at or after base + offset
+	std::size_t AlignedOffset(const unsigned char* base, std::size_t offset, std::size_t alignment)
+	{
+		std::uintptr_t address = std::uintptr_t(base) + offset;
+		std::uintptr_t aligned = (address + alignment - 1) & ~std::uintptr_t(alignment - 1);
+		return offset + std::size_t(aligned - address);
+	}
+}
+
+MonotonicArena::MonotonicArena(std::size_t capacity)
+	: buffer(nullptr), capacity(0), offset(0), used(0), overflow(nullptr), overflowOffset(0)
+{
+	Reserve(capacity);
+}
+
+MonotonicArena::~MonotonicArena()
+{
+	UFreeOverflow();
+	::operator delete(buffer);
+}
+
+///////////////////////////////////////////////////
+//	Reserve(std::size_t)
+//
+//	bytes: smallest buffer size wanted
+//
+//	Release everything, then grow the buffer if it is smaller than bytes.
+//	Memory handed out before is no longer valid.
+///////////////////////////////////////////////////
+void MonotonicArena::Reserve(std::size_t bytes)
+{
+	UFreeOverflow();
+	offset = 0;
+	used = 0;
+
+	if (bytes <= capacity)
+		return;
+
+	::operator delete(buffer);
+	buffer = static_cast<unsigned char*>(::operator new(bytes));
+	capacity = bytes;
+}
+
+///////////////////////////////////////////////////
+//	Reset()
+//
+//	Release everything. If the requests since the last Reset() spilled into
+//	overflow blocks, the buffer is regrown once to hold all of them, so
+//	building the same mesh again stays inside it.
+///////////////////////////////////////////////////
+void MonotonicArena::Reset()
+{
+	// alignment padding may land differently in one buffer, leave room for it
+	std::size_t peak = overflow ? used + used / 8 : 0;
+	Reserve(peak);
+}
+
+void* MonotonicArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	if (bytes == 0)
+		bytes = 1;
+
+	std::size_t start = buffer ? AlignedOffset(buffer, offset, alignment) : capacity + 1;
+	if (!overflow && start + bytes <= capacity)
+	{
+		used += start + bytes - offset;
+		offset = start + bytes;
+		return buffer + start;
+	}
+
+	// the buffer is full; bump inside the most recent overflow block or
+	// start a new one twice the size of the last
+	unsigned char* block = overflow ? reinterpret_cast<unsigned char*>(overflow + 1) : nullptr;
+	start = block ? AlignedOffset(block, overflowOffset, alignment) : 0;
+	if (!block || start + bytes > overflow->size)
+	{
+		std::size_t size = std::max(bytes + alignment, minOverflowBlock);
+		size = std::max(size, overflow ? overflow->size * 2 : capacity);
+
+		OverflowBlock* next = static_cast<OverflowBlock*>(::operator new(sizeof(OverflowBlock) + size));
+		next->next = overflow;
+		next->size = size;
+		overflow = next;
+		overflowOffset = 0;
+
+		block = reinterpret_cast<unsigned char*>(overflow + 1);
+		start = AlignedOffset(block, 0, alignment);
+	}
+
+	used += start + bytes - overflowOffset;
+	overflowOffset = start + bytes;
+	return block + start;
+}
+
+void MonotonicArena::do_deallocate(void*, std::size_t, std::size_t)
+{
+	// freed all at once by Reset()
+}
+
+bool MonotonicArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+void MonotonicArena::UFreeOverflow()
+{
+	while (overflow)
+	{
+		OverflowBlock* next = overflow->next;
+		::operator delete(overflow);
+		overflow = next;
+	}
+	overflowOffset = 0;
+}
+
+MeshBuilder::MeshBuilder(MonotonicArena& arena, GLuint nVertices, GLuint nIndices)
+	: verts(arena.Allocate<GLfloat>(std::size_t(nVertices) * Primitives::floatsPerElement)),
+	indices(arena.Allocate<GLuint>(nIndices)),
+	nVertices(nVertices), nIndices(nIndices), nWrittenVertices(0), nWrittenIndices(0), dropped(false)
+{
+}
+
+MeshBuilder::MeshBuilder(GLfloat* verts, GLuint nVertices, GLuint* indices, GLuint nIndices)
+	: verts(verts), indices(indices),
+	nVertices(nVertices), nIndices(nIndices), nWrittenVertices(0), nWrittenIndices(0), dropped(false)
+{
+}
+
+///////////////////////////////////////////////////
+//	Vertex(const glm::vec3&, const glm::vec3&, const glm::vec2&)
+//
+//	Return the index of the new vertex, relative to the mesh
+///////////////////////////////////////////////////
+GLuint MeshBuilder::Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+{
+	if (nWrittenVertices == nVertices)
+	{
+		dropped = true;
+		return nWrittenVertices;
+	}
+
+	GLfloat* vertex = verts + std::size_t(nWrittenVertices) * Primitives::floatsPerElement;
+	vertex[Primitives::positionOffset + 0] = position.x;
+	vertex[Primitives::positionOffset + 1] = position.y;
+	vertex[Primitives::positionOffset + 2] = position.z;
+	vertex[Primitives::normalOffset + 0] = normal.x;
+	vertex[Primitives::normalOffset + 1] = normal.y;
+	vertex[Primitives::normalOffset + 2] = normal.z;
+	vertex[Primitives::uvOffset + 0] = uv.x;
+	vertex[Primitives::uvOffset + 1] = uv.y;
+	return nWrittenVertices++;
+}
+
+void MeshBuilder::Triangle(GLuint a, GLuint b, GLuint c)
+{
+	if (nIndices - nWrittenIndices < 3)
+	{
+		dropped = true;
+		return;
+	}
+
+	indices[nWrittenIndices++] = a;
+	indices[nWrittenIndices++] = b;
+	indices[nWrittenIndices++] = c;
+}
+
+///////////////////////////////////////////////////
+//	Append(const GLfloat*, GLuint, const GLuint*, GLuint)
+//
+//	blockVerts: interleaved position, normal and texture coords
+//	blockIndices: GL_TRIANGLES indices, 0 being the first of blockVerts
+///////////////////////////////////////////////////
+void MeshBuilder::Append(const GLfloat* blockVerts, GLuint nBlockVertices, const GLuint* blockIndices, GLuint nBlockIndices)
+{
+	if (nVertices - nWrittenVertices < nBlockVertices || nIndices - nWrittenIndices < nBlockIndices)
+	{
+		dropped = true;
+		return;
+	}
+
+	GLuint base = nWrittenVertices;
+	std::copy(blockVerts, blockVerts + std::size_t(nBlockVertices) * Primitives::floatsPerElement,
+		verts + std::size_t(base) * Primitives::floatsPerElement);
+	for (GLuint i = 0; i < nBlockIndices; i++)
+		indices[nWrittenIndices + i] = base + blockIndices[i];
+
+	nWrittenVertices += nBlockVertices;
+	nWrittenIndices += nBlockIndices;
+}
+
+void MeshBuilder::MarkFull()
+{
+	nWrittenVertices = nVertices;
+	nWrittenIndices = nIndices;
+}
+
+bool MeshBuilder::Complete() const
+{
+	return !dropped && nWrittenVertices == nVertices && nWrittenIndices == nIndices;
+}
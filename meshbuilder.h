@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshbuilder.h
+// ========
+// write interleaved vertices and GL_TRIANGLES indices in place, into memory
+// reserved up front from a monotonic arena or supplied by the caller (a
+// mapped GPU buffer range, for example)
+//
+// A mesh is regenerated by calling Reset() on its arena and building again;
+// once the arena has grown to the largest mesh built in it, generation,
+// optimization and validation make no heap allocations.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+
+// Bump allocator over one buffer. Deallocation is a no-op; everything is
+// released together by Reset(). Requests that do not fit go to overflow
+// blocks on the heap, and the next Reset() regrows the buffer to cover them.
+class MonotonicArena : public std::pmr::memory_resource
+{
+public:
+	explicit MonotonicArena(std::size_t capacity = 0);
+	~MonotonicArena();
+
+	// Release everything, growing the buffer to at least bytes
+	void Reserve(std::size_t bytes);
+
+	// Release everything. The buffer is kept, grown to the peak use since
+	// the last Reset() if that did not fit.
+	void Reset();
+
+	std::size_t Used() const { return used; }			// Bytes handed out since the last Reset(), padding included
+	std::size_t Capacity() const { return capacity; }	// Bytes available before falling back to the heap
+
+	// Uninitialized storage for count T
+	template <typename T>
+	T* Allocate(std::size_t count)
+	{
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+private:
+	MonotonicArena(const MonotonicArena&) = delete;
+	MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+	void UFreeOverflow();
+
+	// Overflow blocks are chained through a header at their start
+	struct OverflowBlock
+	{
+		OverflowBlock* next;
+		std::size_t size;	// Bytes after the header
+	};
+
+	unsigned char* buffer;
+	std::size_t capacity;
+	std::size_t offset;		// Next free byte in buffer
+	std::size_t used;
+	OverflowBlock* overflow;	// Most recent block first
+	std::size_t overflowOffset;	// Next free byte in the most recent block
+};
+
+// Cursor over storage for exactly nVertices interleaved vertices (position,
+// normal, texture coords) and nIndices indices. Writes past the reserved
+// counts are dropped and make Complete() fail.
+class MeshBuilder
+{
+public:
+	// Reserve the storage from arena; it lives until the arena is reset
+	MeshBuilder(MonotonicArena& arena, GLuint nVertices, GLuint nIndices);
+
+	// Write into storage owned by the caller
+	MeshBuilder(GLfloat* verts, GLuint nVertices, GLuint* indices, GLuint nIndices);
+
+	GLfloat* Vertices() const { return verts; }
+	GLuint* Indices() const { return indices; }
+	GLuint VertexCapacity() const { return nVertices; }
+	GLuint IndexCapacity() const { return nIndices; }
+	GLuint VertexCount() const { return nWrittenVertices; }
+	GLuint IndexCount() const { return nWrittenIndices; }
+
+	// Append one vertex and return its index
+	GLuint Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv);
+
+	// Append one counter-clockwise triangle
+	void Triangle(GLuint a, GLuint b, GLuint c);
+
+	// Append a block of interleaved vertices and indices relative to the
+	// block; the indices are offset by the vertices written before it
+	void Append(const GLfloat* blockVerts, GLuint nBlockVertices, const GLuint* blockIndices, GLuint nBlockIndices);
+
+	// Record that a generator filled Vertices() and Indices() completely
+	// through the raw pointers
+	void MarkFull();
+
+	// Every reserved vertex and index was written, nothing was dropped
+	bool Complete() const;
+
+	// A write did not fit and was dropped
+	bool Dropped() const { return dropped; }
+
+private:
+	GLfloat* verts;
+	GLuint* indices;
+	GLuint nVertices;
+	GLuint nIndices;
+	GLuint nWrittenVertices;
+	GLuint nWrittenIndices;
+	bool dropped;
+};
@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.cpp
+// ========
+// binary cache of the final mesh arena contents: interleaved float vertices,
+// GLuint indices, and each mesh's draw range and bounds
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	const char cacheMagic[4] = { 'M', 'S', 'H', 'C' };
+
+	std::size_t PayloadSize(GLuint nMeshes, GLuint nVertices, GLuint floatsPerElement, GLuint nIndices)
+	{
+		return sizeof(MeshCache::MeshRange) * nMeshes
+			+ sizeof(GLfloat) * floatsPerElement * nVertices
+			+ sizeof(GLuint) * nIndices;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Hash(const void*, std::size_t, std::uint64_t)
+//
+//	FNV-1a over size bytes of data
+///////////////////////////////////////////////////
+std::uint64_t MeshCache::Hash(const void* data, std::size_t size, std::uint64_t seed)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	std::uint64_t hash = seed;
+	for (std::size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+MeshCache::MappedCache::MappedCache()
+	: header(nullptr), ranges(nullptr), verts(nullptr), indices(nullptr)
+{
+}
+
+MeshCache::MappedCache::~MappedCache()
+{
+	Close();
+}
+
+///////////////////////////////////////////////////
+//	Open(const char*, std::uint64_t, GLuint, GLuint, bool)
+//
+//	path: cache file
+//	paramsHash: hash of the generator parameters the caller would use
+//	nMeshes, floatsPerElement: layout the caller expects
+//	verifyContents: hash the payload against the header too
+//
+//	Map the file and validate it before exposing any pointer. Without
+//	verifyContents only the header page is touched, so opening costs the
+//	mapping and the rest pages in as it is used.
+///////////////////////////////////////////////////
+bool MeshCache::MappedCache::Open(const char* path, std::uint64_t paramsHash, GLuint nMeshes, GLuint floatsPerElement,
+	bool verifyContents)
+{
+	Close();
+
+	if (!file.Open(path) || file.Size() < sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+
+	const unsigned char* data = file.Data();
+	std::size_t size = file.Size();
+
+	const Header* fileHeader = reinterpret_cast<const Header*>(data);
+	if (std::memcmp(fileHeader->magic, cacheMagic, sizeof(cacheMagic)) != 0
+		|| fileHeader->version != fileVersion
+		|| fileHeader->paramsHash != paramsHash
+		|| fileHeader->nMeshes != nMeshes
+		|| fileHeader->floatsPerElement != floatsPerElement
+		|| size != sizeof(Header) + PayloadSize(nMeshes, fileHeader->nVertices, floatsPerElement, fileHeader->nIndices)
+		|| (verifyContents && Hash(data + sizeof(Header), size - sizeof(Header)) != fileHeader->contentHash))
+	{
+		Close();
+		return false;
+	}
+
+	header = fileHeader;
+	ranges = reinterpret_cast<const MeshRange*>(data + sizeof(Header));
+	verts = reinterpret_cast<const GLfloat*>(ranges + nMeshes);
+	indices = reinterpret_cast<const GLuint*>(verts + std::size_t(floatsPerElement) * header->nVertices);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Close()
+//
+//	Unmap the file; safe to call when nothing is mapped
+///////////////////////////////////////////////////
+void MeshCache::MappedCache::Close()
+{
+	file.Close();
+
+	header = nullptr;
+	ranges = nullptr;
+	verts = nullptr;
+	indices = nullptr;
+}
+
+///////////////////////////////////////////////////
+//	Write(const char*, std::uint64_t, const MeshRange*, GLuint, const GLfloat*, GLuint, GLuint, const GLuint*, GLuint)
+//
+//	Write a cache file next to path and move it into place, so a reader
+//	never sees a partial file
+///////////////////////////////////////////////////
+bool MeshCache::Write(const char* path, std::uint64_t paramsHash,
+	const MeshRange* ranges, GLuint nMeshes,
+	const GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+	const GLuint* indices, GLuint nIndices)
+{
+	Header header;
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = fileVersion;
+	header.paramsHash = paramsHash;
+	header.nMeshes = nMeshes;
+	header.nVertices = nVertices;
+	header.nIndices = nIndices;
+	header.floatsPerElement = floatsPerElement;
+
+	std::size_t rangeBytes = sizeof(MeshRange) * nMeshes;
+	std::size_t vertexBytes = sizeof(GLfloat) * floatsPerElement * nVertices;
+	std::size_t indexBytes = sizeof(GLuint) * nIndices;
+
+	header.contentHash = Hash(ranges, rangeBytes);
+	header.contentHash = Hash(verts, vertexBytes, header.contentHash);
+	header.contentHash = Hash(indices, indexBytes, header.contentHash);
+
+	std::string tempPath = std::string(path) + ".tmp";
+	std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+	if (!file)
+	{
+		std::cout << "Failed to write mesh cache " << tempPath << std::endl;
+		return false;
+	}
+
+	bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+		&& std::fwrite(ranges, 1, rangeBytes, file) == rangeBytes
+		&& std::fwrite(verts, 1, vertexBytes, file) == vertexBytes
+		&& std::fwrite(indices, 1, indexBytes, file) == indexBytes;
+	written = std::fclose(file) == 0 && written;
+
+	// rename does not replace an existing file on every platform
+	std::remove(path);
+	if (!written || std::rename(tempPath.c_str(), path) != 0)
+	{
+		std::remove(tempPath.c_str());
+		std::cout << "Failed to write mesh cache " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcache.h
+// ========
+// binary cache of the final mesh arena contents: interleaved float vertices,
+// GLuint indices, and each mesh's draw range and bounds
+//
+// File layout: Header, MeshRange[nMeshes], GLfloat vertices, GLuint indices.
+// The file is memory-mapped on load and the arrays are used in place.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "mappedfile.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MeshCache
+{
+	// Bump when the file layout changes
+	const GLuint fileVersion = 1;
+
+	struct Header
+	{
+		char magic[4];				// "MSHC"
+		GLuint version;				// fileVersion at write time
+		std::uint64_t paramsHash;	// generator parameters the data was built from
+		std::uint64_t contentHash;	// hash of everything after the header, checked on request
+		GLuint nMeshes;
+		GLuint nVertices;
+		GLuint nIndices;
+		GLuint floatsPerElement;
+	};
+
+	struct MeshRange
+	{
+		GLuint baseVertex;
+		GLuint nVertices;
+		GLuint firstIndex;
+		GLuint nIndices;
+		GLfloat boundsMin[3];
+		GLfloat boundsMax[3];
+	};
+
+	// FNV-1a, 64 bit; pass the previous result as seed to hash several blocks
+	const std::uint64_t hashSeed = 14695981039346656037ull;
+	std::uint64_t Hash(const void* data, std::size_t size, std::uint64_t seed = hashSeed);
+
+	// Read-only mapping of a cache file. Pointers are valid until Close()
+	// or destruction.
+	class MappedCache
+	{
+	public:
+		MappedCache();
+		~MappedCache();
+
+		// Fails, leaving nothing mapped, when the file is missing, truncated,
+		// of another version, or built from other parameters. Only the
+		// header is read; verifyContents also hashes the whole payload to
+		// catch corruption, reading every page up front.
+		bool Open(const char* path, std::uint64_t paramsHash, GLuint nMeshes, GLuint floatsPerElement,
+			bool verifyContents = false);
+		void Close();
+
+		const Header* header;
+		const MeshRange* ranges;
+		const GLfloat* verts;
+		const GLuint* indices;
+
+	private:
+		MappedCache(const MappedCache&) = delete;
+		MappedCache& operator=(const MappedCache&) = delete;
+
+		MappedFile file;
+	};
+
+	bool Write(const char* path, std::uint64_t paramsHash,
+		const MeshRange* ranges, GLuint nMeshes,
+		const GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+		const GLuint* indices, GLuint nIndices);
+}
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshes.h
+// ========
+// create meshes for various 3D primitives: plane, pyramid, cube, cylinder, torus, sphere
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 7th, 2022
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include "meshbuilder.h"
+#include "meshvalidate.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ModelImport
+{
+	struct Model;
+}
+
+class Meshes
+{
+public:
+	// Identifies a mesh in the registry. The generated primitives have the
+	// fixed ids below; imported model meshes are numbered after them, in
+	// import order.
+	typedef GLuint MeshId;
+	enum BuiltinMesh : MeshId
+	{
+		BoxMesh, ConeMesh, CylinderMesh, PlaneMesh, PrismMesh,
+		Pyramid3Mesh, Pyramid4Mesh, SphereMesh, TaperedCylinderMesh, TorusMesh,
+		nBuiltinMeshes
+	};
+
+	// Everything needed to draw one mesh out of the shared vertex and index
+	// buffers
+	struct GLMesh
+	{
+		GLenum primitive;	// GL_TRIANGLES for every mesh built here
+		GLuint baseVertex;	// First vertex of the mesh in the shared vertex buffer
+		GLuint nVertices;	// Number of vertices for the mesh
+		GLuint firstIndex;	// First index of the mesh in the shared index buffer
+		GLuint nIndices;    // Number of indices for the mesh
+		GLintptr indexOffset;	// Byte offset of firstIndex, passed to glDrawElementsBaseVertex
+		GLenum indexType;	// GL_UNSIGNED_INT or GL_UNSIGNED_SHORT, GL_NONE when not indexed
+		glm::vec3 boundsMin;	// Model space bounding box
+		glm::vec3 boundsMax;
+	};
+
+	// CPU side result of generating one mesh, before it joins the arena.
+	// verts and indices point into arena; Reset() it to build again.
+	struct MeshData
+	{
+		const char* name = nullptr;		// Used in the load report
+		MonotonicArena arena;			// Holds verts, indices and the optimizer scratch
+		GLfloat* verts = nullptr;		// Interleaved position, normal and texture coords
+		GLuint nVertices = 0;
+		GLuint* indices = nullptr;		// GL_TRIANGLES indices, relative to the mesh
+		GLuint nIndices = 0;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		float acmrBefore = 0.0f;		// Vertex cache cost before and after optimization
+		float acmrAfter = 0.0f;
+		MeshValidate::WindingReport winding;	// Checked before optimization
+	};
+
+	// Meshes of an imported model file, in file order
+	struct Model
+	{
+		std::string path;				// .obj, .gltf or .glb
+		std::vector<MeshId> meshes;		// Registry ids, empty when the import failed
+		std::vector<std::string> names;	// Mesh names from the file
+	};
+
+	// Tessellation used by CreateMeshes() for the generated primitives
+	struct MeshSettings
+	{
+		GLuint cylinderSegments = 36;	// Slices around the cylinder axis
+		GLuint coneSegments = 36;		// Slices around the cone axis
+		GLuint sphereSectors = 16;		// Slices around the sphere axis
+		GLuint sphereStacks = 16;		// Rings from pole to pole
+		GLuint torusMainSegments = 30;	// Slices around the torus ring
+		GLuint torusTubeSegments = 30;	// Slices around the torus tube
+		float torusMainRadius = 1.0f;	// Distance from the center to the tube center
+		float torusTubeRadius = 0.1f;	// Radius of the tube
+
+		// Store vertices in VertexFormat::PackedVertex (16 bytes) instead of
+		// floats (32 bytes) and use 16-bit indices where they fit. Shaders
+		// must set ubOctNormals to match.
+		bool packedVertices = false;
+
+		// Binary cache of the generated meshes, rebuilt whenever the
+		// tessellation settings change. nullptr always generates.
+		const char* cachePath = "meshes.cache";
+		bool verifyCache = false;	// Hash the whole cache on load to catch a corrupt file
+	};
+
+	MeshSettings settings;
+
+	// Every mesh lives in these, bind vao once and draw any of them
+	GLuint vao;         // Handle for the vertex array object
+	GLuint vbos[2];     // Handles for the vertex and index buffer objects
+
+	// Imported models; their meshes share vao with the primitives
+	std::vector<Model> models;
+
+public:
+	// Queue a model file for CreateMeshes() to import, return its index in
+	// models
+	size_t AddModel(const char* path);
+
+	void CreateMeshes();
+	void DestroyMeshes();
+
+	// Draw descriptor of a mesh; valid once CreateMeshes() has run
+	const GLMesh& Mesh(MeshId id) const { return registry[id]; }
+	MeshId MeshCount() const { return MeshId(registry.size()); }
+
+	// Draw instanceCount instances of any mesh with vao bound
+	void Draw(MeshId id, GLsizei instanceCount = 1) const;
+
+private:
+	void UCreatePlaneMesh(MeshData& data);
+	void UCreatePrismMesh(MeshData& data);
+	void UCreateBoxMesh(MeshData& data);
+	void UCreateConeMesh(MeshData& data);
+	void UCreateCylinderMesh(MeshData& data);
+	void UCreateTaperedCylinderMesh(MeshData& data);
+	void UCreatePyramid3Mesh(MeshData& data);
+	void UCreatePyramid4Mesh(MeshData& data);
+	void UCreateSphereMesh(MeshData& data);
+	void UCreateTorusMesh(MeshData& data);
+
+	void UBuildIndexedMesh(MeshData& data, const char* name, const GLfloat* verts, GLuint nVertices, const GLuint* indices, GLuint nIndices);
+	void UBuildIndexedMesh(MeshData& data, const char* name, const MeshBuilder& builder);
+	static void UComputeBounds(MeshData& data);
+	bool UImportModel(Model& model, ModelImport::Model& imported);
+	void UAddMesh(GLMesh& mesh, const MeshData& data);
+	void UUploadArena(const GLfloat* verts, GLuint nVertices, const GLuint* indices, GLuint nIndices);
+	std::uint64_t UHashSettings() const;
+
+	// Every mesh in the arena, indexed by MeshId
+	std::vector<GLMesh> registry;
+
+	// CPU copies of the generated arena contents, freed once uploaded
+	std::vector<GLfloat> stagingVerts;
+	std::vector<GLuint> stagingIndices;
+};
@@ -0,0 +1,297 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshnormals.cpp
+// ========
+// batched face normal, smooth vertex normal and tangent generation for
+// indexed GL_TRIANGLES meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshnormals.h"
+#include "primitives.h"
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHNORMALS_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	///////////////////////////////////////////////////
+	//	NormalizeArrays(float*, float*, float*, GLuint)
+	//
+	//	Normalize n vectors in place; zero length vectors stay zero
+	///////////////////////////////////////////////////
+	void NormalizeArrays(float* x, float* y, float* z, GLuint n)
+	{
+		GLuint i = 0;
+
+#ifdef MESHNORMALS_SSE
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 vx = _mm_loadu_ps(x + i);
+			__m128 vy = _mm_loadu_ps(y + i);
+			__m128 vz = _mm_loadu_ps(z + i);
+
+			__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+			__m128 nonZero = _mm_cmpgt_ps(lengthSq, zero);
+			__m128 length = _mm_sqrt_ps(_mm_or_ps(lengthSq, _mm_andnot_ps(nonZero, _mm_set1_ps(1.0f))));
+
+			_mm_storeu_ps(x + i, _mm_and_ps(_mm_div_ps(vx, length), nonZero));
+			_mm_storeu_ps(y + i, _mm_and_ps(_mm_div_ps(vy, length), nonZero));
+			_mm_storeu_ps(z + i, _mm_and_ps(_mm_div_ps(vz, length), nonZero));
+		}
+#endif
+
+		for (; i < n; i++)
+		{
+			float lengthSq = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+			if (lengthSq > 0.0f)
+			{
+				float length = std::sqrt(lengthSq);
+				x[i] /= length;
+				y[i] /= length;
+				z[i] /= length;
+			}
+			else
+			{
+				x[i] = y[i] = z[i] = 0.0f;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	FaceNormals(...)
+//
+//	px, py, pz: vertex positions
+//	indices: 3 * nTriangles GL_TRIANGLES indices
+//	nx, ny, nz: receive nTriangles face normals
+///////////////////////////////////////////////////
+void MeshNormals::FaceNormals(const float* px, const float* py, const float* pz,
+	const GLuint* indices, GLuint nTriangles,
+	float* nx, float* ny, float* nz)
+{
+	GLuint t = 0;
+
+#ifdef MESHNORMALS_SSE
+	// four triangles per step; the corners are gathered into lanes
+	for (; t + 4 <= nTriangles; t += 4)
+	{
+		const GLuint* tri = indices + 3 * t;
+
+		__m128 p0x = _mm_setr_ps(px[tri[0]], px[tri[3]], px[tri[6]], px[tri[9]]);
+		__m128 p0y = _mm_setr_ps(py[tri[0]], py[tri[3]], py[tri[6]], py[tri[9]]);
+		__m128 p0z = _mm_setr_ps(pz[tri[0]], pz[tri[3]], pz[tri[6]], pz[tri[9]]);
+
+		__m128 e1x = _mm_sub_ps(_mm_setr_ps(px[tri[1]], px[tri[4]], px[tri[7]], px[tri[10]]), p0x);
+		__m128 e1y = _mm_sub_ps(_mm_setr_ps(py[tri[1]], py[tri[4]], py[tri[7]], py[tri[10]]), p0y);
+		__m128 e1z = _mm_sub_ps(_mm_setr_ps(pz[tri[1]], pz[tri[4]], pz[tri[7]], pz[tri[10]]), p0z);
+
+		__m128 e2x = _mm_sub_ps(_mm_setr_ps(px[tri[2]], px[tri[5]], px[tri[8]], px[tri[11]]), p0x);
+		__m128 e2y = _mm_sub_ps(_mm_setr_ps(py[tri[2]], py[tri[5]], py[tri[8]], py[tri[11]]), p0y);
+		__m128 e2z = _mm_sub_ps(_mm_setr_ps(pz[tri[2]], pz[tri[5]], pz[tri[8]], pz[tri[11]]), p0z);
+
+		_mm_storeu_ps(nx + t, _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y)));
+		_mm_storeu_ps(ny + t, _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z)));
+		_mm_storeu_ps(nz + t, _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x)));
+	}
+#endif
+
+	for (; t < nTriangles; t++)
+	{
+		GLuint i0 = indices[3 * t];
+		GLuint i1 = indices[3 * t + 1];
+		GLuint i2 = indices[3 * t + 2];
+
+		float e1x = px[i1] - px[i0], e1y = py[i1] - py[i0], e1z = pz[i1] - pz[i0];
+		float e2x = px[i2] - px[i0], e2y = py[i2] - py[i0], e2z = pz[i2] - pz[i0];
+
+		nx[t] = e1y * e2z - e1z * e2y;
+		ny[t] = e1z * e2x - e1x * e2z;
+		nz[t] = e1x * e2y - e1y * e2x;
+	}
+}
+
+///////////////////////////////////////////////////
+//	SmoothNormals(...)
+//
+//	px, py, pz: vertex positions
+//	indices: GL_TRIANGLES indices
+//	nx, ny, nz: receive nVertices unit normals
+//
+//	Face normals are left unnormalized before they are summed, which
+//	weights each by its triangle's area
+///////////////////////////////////////////////////
+void MeshNormals::SmoothNormals(const float* px, const float* py, const float* pz, GLuint nVertices,
+	const GLuint* indices, GLuint nIndices,
+	float* nx, float* ny, float* nz, std::pmr::memory_resource* scratch)
+{
+	GLuint nTriangles = nIndices / 3;
+
+	std::pmr::vector<float> faceNormals(3 * size_t(nTriangles), 0.0f, scratch);
+	float* fx = faceNormals.data();
+	float* fy = fx + nTriangles;
+	float* fz = fy + nTriangles;
+	FaceNormals(px, py, pz, indices, nTriangles, fx, fy, fz);
+
+	for (GLuint v = 0; v < nVertices; v++)
+		nx[v] = ny[v] = nz[v] = 0.0f;
+
+	for (GLuint t = 0; t < nTriangles; t++)
+	{
+		for (GLuint corner = 0; corner < 3; corner++)
+		{
+			GLuint v = indices[3 * t + corner];
+			nx[v] += fx[t];
+			ny[v] += fy[t];
+			nz[v] += fz[t];
+		}
+	}
+
+	NormalizeArrays(nx, ny, nz, nVertices);
+}
+
+///////////////////////////////////////////////////
+//	Tangents(...)
+//
+//	px, py, pz: vertex positions
+//	u, v: vertex texture coords
+//	nx, ny, nz: unit vertex normals
+//	indices: GL_TRIANGLES indices
+//	tx, ty, tz, tw: receive nVertices tangents and bitangent signs
+//
+//	Per-triangle texture space directions summed at each vertex, then
+//	Gram-Schmidt orthogonalized against the normal
+///////////////////////////////////////////////////
+void MeshNormals::Tangents(const float* px, const float* py, const float* pz,
+	const float* u, const float* v,
+	const float* nx, const float* ny, const float* nz, GLuint nVertices,
+	const GLuint* indices, GLuint nIndices,
+	float* tx, float* ty, float* tz, float* tw, std::pmr::memory_resource* scratch)
+{
+	std::pmr::vector<float> bitangents(3 * size_t(nVertices), 0.0f, scratch);
+	float* bx = bitangents.data();
+	float* by = bx + nVertices;
+	float* bz = by + nVertices;
+
+	for (GLuint i = 0; i < nVertices; i++)
+		tx[i] = ty[i] = tz[i] = 0.0f;
+
+	for (GLuint i = 0; i + 2 < nIndices; i += 3)
+	{
+		GLuint i0 = indices[i];
+		GLuint i1 = indices[i + 1];
+		GLuint i2 = indices[i + 2];
+
+		float e1x = px[i1] - px[i0], e1y = py[i1] - py[i0], e1z = pz[i1] - pz[i0];
+		float e2x = px[i2] - px[i0], e2y = py[i2] - py[i0], e2z = pz[i2] - pz[i0];
+		float du1 = u[i1] - u[i0], dv1 = v[i1] - v[i0];
+		float du2 = u[i2] - u[i0], dv2 = v[i2] - v[i0];
+
+		// skip triangles with degenerate texture mapping
+		float det = du1 * dv2 - du2 * dv1;
+		if (std::fabs(det) < 1e-12f)
+			continue;
+		float r = 1.0f / det;
+
+		float sx = (e1x * dv2 - e2x * dv1) * r;
+		float sy = (e1y * dv2 - e2y * dv1) * r;
+		float sz = (e1z * dv2 - e2z * dv1) * r;
+		float qx = (e2x * du1 - e1x * du2) * r;
+		float qy = (e2y * du1 - e1y * du2) * r;
+		float qz = (e2z * du1 - e1z * du2) * r;
+
+		const GLuint corners[3] = { i0, i1, i2 };
+		for (GLuint corner : corners)
+		{
+			tx[corner] += sx;
+			ty[corner] += sy;
+			tz[corner] += sz;
+			bx[corner] += qx;
+			by[corner] += qy;
+			bz[corner] += qz;
+		}
+	}
+
+	// t = t - n * dot(n, t)
+	GLuint i = 0;
+
+#ifdef MESHNORMALS_SSE
+	for (; i + 4 <= nVertices; i += 4)
+	{
+		__m128 vnx = _mm_loadu_ps(nx + i);
+		__m128 vny = _mm_loadu_ps(ny + i);
+		__m128 vnz = _mm_loadu_ps(nz + i);
+		__m128 vtx = _mm_loadu_ps(tx + i);
+		__m128 vty = _mm_loadu_ps(ty + i);
+		__m128 vtz = _mm_loadu_ps(tz + i);
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vnx, vtx), _mm_mul_ps(vny, vty)), _mm_mul_ps(vnz, vtz));
+		_mm_storeu_ps(tx + i, _mm_sub_ps(vtx, _mm_mul_ps(vnx, dot)));
+		_mm_storeu_ps(ty + i, _mm_sub_ps(vty, _mm_mul_ps(vny, dot)));
+		_mm_storeu_ps(tz + i, _mm_sub_ps(vtz, _mm_mul_ps(vnz, dot)));
+	}
+#endif
+
+	for (; i < nVertices; i++)
+	{
+		float dot = nx[i] * tx[i] + ny[i] * ty[i] + nz[i] * tz[i];
+		tx[i] -= nx[i] * dot;
+		ty[i] -= ny[i] * dot;
+		tz[i] -= nz[i] * dot;
+	}
+
+	NormalizeArrays(tx, ty, tz, nVertices);
+
+	if (!tw)
+		return;
+
+	for (i = 0; i < nVertices; i++)
+	{
+		// cross(n, t) . b
+		float cx = ny[i] * tz[i] - nz[i] * ty[i];
+		float cy = nz[i] * tx[i] - nx[i] * tz[i];
+		float cz = nx[i] * ty[i] - ny[i] * tx[i];
+		tw[i] = (cx * bx[i] + cy * by[i] + cz * bz[i]) < 0.0f ? -1.0f : 1.0f;
+	}
+}
+
+///////////////////////////////////////////////////
+//	GenerateNormals(GLfloat*, GLuint, GLuint, const GLuint*, GLuint, std::pmr::memory_resource*)
+//
+//	verts: interleaved vertices in the Primitives layout, normals
+//		overwritten in place
+//	indices: GL_TRIANGLES indices
+///////////////////////////////////////////////////
+void MeshNormals::GenerateNormals(GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+	const GLuint* indices, GLuint nIndices, std::pmr::memory_resource* scratch)
+{
+	std::pmr::vector<float> soa(6 * size_t(nVertices), 0.0f, scratch);
+	float* px = soa.data();
+	float* py = px + nVertices;
+	float* pz = py + nVertices;
+	float* nx = pz + nVertices;
+	float* ny = nx + nVertices;
+	float* nz = ny + nVertices;
+
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		const GLfloat* position = verts + v * floatsPerElement + Primitives::positionOffset;
+		px[v] = position[0];
+		py[v] = position[1];
+		pz[v] = position[2];
+	}
+
+	SmoothNormals(px, py, pz, nVertices, indices, nIndices, nx, ny, nz, scratch);
+
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		GLfloat* normal = verts + v * floatsPerElement + Primitives::normalOffset;
+		normal[0] = nx[v];
+		normal[1] = ny[v];
+		normal[2] = nz[v];
+	}
+}
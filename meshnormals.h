@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshnormals.h
+// ========
+// batched face normal, smooth vertex normal and tangent generation for
+// indexed GL_TRIANGLES meshes
+//
+// The kernels work on structure-of-arrays data (separate x, y, z arrays)
+// and use SSE where the compiler targets it. GenerateNormals() wraps them
+// for the interleaved layout the meshes are stored in. Temporary arrays
+// come from scratch.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <memory_resource>
+
+namespace MeshNormals
+{
+	// Unnormalized face normal of every triangle, cross(p1 - p0, p2 - p0).
+	// Its length is twice the triangle area.
+	void FaceNormals(const float* px, const float* py, const float* pz,
+		const GLuint* indices, GLuint nTriangles,
+		float* nx, float* ny, float* nz);
+
+	// Area-weighted average of the face normals around each vertex,
+	// normalized. Vertices used by no triangle get a zero normal.
+	void SmoothNormals(const float* px, const float* py, const float* pz, GLuint nVertices,
+		const GLuint* indices, GLuint nIndices,
+		float* nx, float* ny, float* nz,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	// Per-vertex tangent along increasing u, orthogonal to the normal, with
+	// the bitangent sign in tw (bitangent = tw * cross(n, t)). tw may be
+	// null.
+	void Tangents(const float* px, const float* py, const float* pz,
+		const float* u, const float* v,
+		const float* nx, const float* ny, const float* nz, GLuint nVertices,
+		const GLuint* indices, GLuint nIndices,
+		float* tx, float* ty, float* tz, float* tw,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	// SmoothNormals() for interleaved vertices; reads the position at
+	// Primitives::positionOffset and writes the normal at
+	// Primitives::normalOffset of each element
+	void GenerateNormals(GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+		const GLuint* indices, GLuint nIndices,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+}
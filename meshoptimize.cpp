@@ -0,0 +1,373 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimize.cpp
+// ========
+// reorder indexed triangle meshes for the GPU: post-transform vertex cache
+// locality (Tipsify), overdraw, and vertex fetch locality
+//
+// Vertex cache and overdraw passes follow Sander, Nehab and Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshoptimize.h"
+#include "primitives.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// FIFO post-transform cache model, using timestamps instead of a queue
+	class CacheSimulator
+	{
+	public:
+		CacheSimulator(GLuint nVertices, GLuint cacheSize, std::pmr::memory_resource* scratch)
+			: timestamps(nVertices, 0, scratch), size(cacheSize), time(cacheSize + 1)
+		{
+		}
+
+		// returns 1 when the vertex had to be transformed
+		GLuint Access(GLuint vertex)
+		{
+			if (time - timestamps[vertex] > size)
+			{
+				timestamps[vertex] = time++;
+				return 1;
+			}
+			return 0;
+		}
+
+		void Flush()
+		{
+			time += size + 1;
+		}
+
+	private:
+		std::pmr::vector<GLuint> timestamps;
+		GLuint size;
+		GLuint time;
+	};
+
+	// vertex to triangle adjacency in compressed rows
+	struct Adjacency
+	{
+		explicit Adjacency(std::pmr::memory_resource* scratch)
+			: offsets(scratch), triangles(scratch), live(scratch)
+		{
+		}
+
+		std::pmr::vector<GLuint> offsets;	// first entry of each vertex in triangles
+		std::pmr::vector<GLuint> triangles;	// triangle numbers, grouped by vertex
+		std::pmr::vector<GLuint> live;		// not yet emitted triangles per vertex
+	};
+
+	void BuildAdjacency(Adjacency& adjacency, const GLuint* indices, GLuint nIndices, GLuint nVertices)
+	{
+		adjacency.live.assign(nVertices, 0);
+		for (GLuint i = 0; i < nIndices; i++)
+			adjacency.live[indices[i]]++;
+
+		adjacency.offsets.assign(nVertices + 1, 0);
+		for (GLuint v = 0; v < nVertices; v++)
+			adjacency.offsets[v + 1] = adjacency.offsets[v] + adjacency.live[v];
+
+		std::pmr::vector<GLuint> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1, adjacency.offsets.get_allocator());
+		adjacency.triangles.resize(nIndices);
+		for (GLuint i = 0; i < nIndices; i++)
+			adjacency.triangles[fill[indices[i]]++] = i / 3;
+	}
+
+	// Tipsify: pick the next fanning vertex from the 1-ring of the last one
+	int GetNextVertex(const std::pmr::vector<GLuint>& candidates, const std::pmr::vector<GLuint>& timestamps,
+		GLuint time, GLuint cacheSize, const std::pmr::vector<GLuint>& live)
+	{
+		int best = -1;
+		int bestPriority = -1;
+		for (GLuint v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+
+			// prefer vertices that will still be in the cache after their fan
+			int priority = 0;
+			if (time - timestamps[v] + 2 * live[v] <= cacheSize)
+				priority = int(time - timestamps[v]);
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = int(v);
+			}
+		}
+		return best;
+	}
+
+	// Tipsify: no candidate left in the cache, restart from the dead-end stack
+	// or from the next vertex in input order
+	int SkipDeadEnd(std::pmr::vector<GLuint>& deadEnd, const std::pmr::vector<GLuint>& live, GLuint& cursor, GLuint nVertices)
+	{
+		while (!deadEnd.empty())
+		{
+			GLuint v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0)
+				return int(v);
+		}
+		while (cursor < nVertices)
+		{
+			if (live[cursor] > 0)
+				return int(cursor);
+			cursor++;
+		}
+		return -1;
+	}
+
+	struct Cluster
+	{
+		GLuint begin;	// first triangle
+		GLuint end;		// one past the last triangle
+		float sortKey;
+	};
+}
+
+///////////////////////////////////////////////////
+//	ACMR(const GLuint*, GLuint, GLuint, GLuint, std::pmr::memory_resource*)
+//
+//	Return the average cache miss ratio: vertex shader invocations per
+//	triangle for a FIFO post-transform cache. 0.5 is the ideal for a large
+//	regular grid, 3.0 means no reuse at all.
+///////////////////////////////////////////////////
+float MeshOptimize::ACMR(const GLuint* indices, GLuint nIndices, GLuint nVertices, GLuint cacheSize,
+	std::pmr::memory_resource* scratch)
+{
+	if (nIndices == 0)
+		return 0.0f;
+
+	CacheSimulator cache(nVertices, cacheSize, scratch);
+	GLuint misses = 0;
+	for (GLuint i = 0; i < nIndices; i++)
+		misses += cache.Access(indices[i]);
+
+	return float(misses) / float(nIndices / 3);
+}
+
+///////////////////////////////////////////////////
+//	OptimizeVertexCache(GLuint*, GLuint, GLuint, std::pmr::vector<GLuint>&, GLuint,
+//		std::pmr::memory_resource*)
+//
+//	clusters: receives the first triangle of every run that starts with a
+//	cold cache, used by OptimizeOverdraw()
+//
+//	Reorder triangles with Tipsify so that vertices are reused while they
+//	are still in the post-transform cache
+///////////////////////////////////////////////////
+void MeshOptimize::OptimizeVertexCache(GLuint* indices, GLuint nIndices, GLuint nVertices,
+	std::pmr::vector<GLuint>& clusters, GLuint cacheSize, std::pmr::memory_resource* scratch)
+{
+	clusters.clear();
+	if (nIndices == 0)
+		return;
+
+	Adjacency adjacency(scratch);
+	BuildAdjacency(adjacency, indices, nIndices, nVertices);
+
+	// every corner is pushed once at most, so nothing below grows past its
+	// reservation
+	const GLuint nTriangles = nIndices / 3;
+	std::pmr::vector<GLuint> output(scratch);
+	std::pmr::vector<bool> emitted(nTriangles, false, scratch);
+	std::pmr::vector<GLuint> timestamps(nVertices, 0, scratch);
+	std::pmr::vector<GLuint> deadEnd(scratch);
+	std::pmr::vector<GLuint> candidates(scratch);
+	output.reserve(nIndices);
+	deadEnd.reserve(nIndices);
+	candidates.reserve(nIndices);
+	clusters.reserve(nTriangles);
+
+	GLuint time = cacheSize + 1;
+	GLuint cursor = 0;
+	int fanning = indices[0];
+	clusters.push_back(0);
+
+	while (fanning >= 0)
+	{
+		candidates.clear();
+
+		GLuint v = GLuint(fanning);
+		for (GLuint a = adjacency.offsets[v]; a < adjacency.offsets[v + 1]; a++)
+		{
+			GLuint triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+
+			for (GLuint k = 0; k < 3; k++)
+			{
+				GLuint corner = indices[triangle * 3 + k];
+				output.push_back(corner);
+				deadEnd.push_back(corner);
+				candidates.push_back(corner);
+				adjacency.live[corner]--;
+				if (time - timestamps[corner] > cacheSize)
+					timestamps[corner] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		fanning = GetNextVertex(candidates, timestamps, time, cacheSize, adjacency.live);
+		if (fanning < 0)
+		{
+			fanning = SkipDeadEnd(deadEnd, adjacency.live, cursor, nVertices);
+			// a restart from outside the cache starts a new cluster
+			if (fanning >= 0 && time - timestamps[fanning] > cacheSize)
+				clusters.push_back(GLuint(output.size() / 3));
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+///////////////////////////////////////////////////
+//	OptimizeOverdraw(GLuint*, GLuint, const GLfloat*, GLuint, GLuint,
+//		const std::pmr::vector<GLuint>&, GLuint, float, std::pmr::memory_resource*)
+//
+//	verts: interleaved vertex data, position at Primitives::positionOffset
+//	clusters: output of OptimizeVertexCache()
+//	threshold: how much worse than the cluster's own ACMR a split may be
+//
+//	Split the cache-optimized clusters further where that costs little, then
+//	draw the clusters that face away from the mesh center first, since they
+//	are the ones most likely to hide the rest.
+///////////////////////////////////////////////////
+void MeshOptimize::OptimizeOverdraw(GLuint* indices, GLuint nIndices, const GLfloat* verts, GLuint nVertices,
+	GLuint floatsPerElement, const std::pmr::vector<GLuint>& clusters, GLuint cacheSize, float threshold,
+	std::pmr::memory_resource* scratch)
+{
+	const GLuint nTriangles = nIndices / 3;
+	if (nTriangles == 0 || clusters.empty())
+		return;
+
+	// soft boundaries inside the hard ones
+	std::pmr::vector<Cluster> split(scratch);
+	split.reserve(nTriangles);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		GLuint begin = clusters[c];
+		GLuint end = (c + 1 < clusters.size()) ? clusters[c + 1] : nTriangles;
+
+		float limit = ACMR(indices + begin * 3, (end - begin) * 3, nVertices, cacheSize, scratch) * threshold;
+
+		CacheSimulator cache(nVertices, cacheSize, scratch);
+		GLuint misses = 0;
+		GLuint last = begin;
+		for (GLuint t = begin; t < end; t++)
+		{
+			for (GLuint k = 0; k < 3; k++)
+				misses += cache.Access(indices[t * 3 + k]);
+
+			if (t + 1 < end && float(misses) / float(t + 1 - last) <= limit)
+			{
+				split.push_back({ last, t + 1, 0.0f });
+				last = t + 1;
+				misses = 0;
+				cache.Flush();
+			}
+		}
+		split.push_back({ last, end, 0.0f });
+	}
+
+	if (split.size() < 2)
+		return;
+
+	// mesh centroid
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+	for (GLuint v = 0; v < nVertices; v++)
+		for (GLuint axis = 0; axis < 3; axis++)
+			center[axis] += verts[v * floatsPerElement + Primitives::positionOffset + axis];
+	for (GLuint axis = 0; axis < 3; axis++)
+		center[axis] /= float(nVertices);
+
+	// dot(cluster centroid - mesh centroid, cluster normal)
+	for (Cluster& cluster : split)
+	{
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+
+		for (GLuint t = cluster.begin; t < cluster.end; t++)
+		{
+			const GLfloat* p0 = verts + indices[t * 3] * floatsPerElement + Primitives::positionOffset;
+			const GLfloat* p1 = verts + indices[t * 3 + 1] * floatsPerElement + Primitives::positionOffset;
+			const GLfloat* p2 = verts + indices[t * 3 + 2] * floatsPerElement + Primitives::positionOffset;
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0],
+			};
+			float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (GLuint axis = 0; axis < 3; axis++)
+			{
+				normal[axis] += n[axis];
+				centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) / 3.0f * triangleArea;
+			}
+			area += triangleArea;
+		}
+
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (area > 0.0f && length > 0.0f)
+		{
+			cluster.sortKey = 0.0f;
+			for (GLuint axis = 0; axis < 3; axis++)
+				cluster.sortKey += (centroid[axis] / area - center[axis]) * normal[axis] / length;
+		}
+	}
+
+	// ties keep their input order, like a stable sort, without the
+	// temporary buffer std::stable_sort allocates
+	std::sort(split.begin(), split.end(),
+		[](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey || (a.sortKey == b.sortKey && a.begin < b.begin); });
+
+	std::pmr::vector<GLuint> output(scratch);
+	output.reserve(nIndices);
+	for (const Cluster& cluster : split)
+		output.insert(output.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+///////////////////////////////////////////////////
+//	OptimizeVertexFetch(GLfloat*, GLuint, GLuint, GLuint*, GLuint, std::pmr::memory_resource*)
+//
+//	Reorder vertices into the order the index buffer first uses them, so
+//	vertex fetch walks memory forwards. Unreferenced vertices are dropped.
+//
+//	Return the new number of vertices
+///////////////////////////////////////////////////
+GLuint MeshOptimize::OptimizeVertexFetch(GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+	GLuint* indices, GLuint nIndices, std::pmr::memory_resource* scratch)
+{
+	const GLuint unused = ~0u;
+	std::pmr::vector<GLuint> remap(nVertices, unused, scratch);
+	GLuint next = 0;
+
+	for (GLuint i = 0; i < nIndices; i++)
+	{
+		GLuint& target = remap[indices[i]];
+		if (target == unused)
+			target = next++;
+		indices[i] = target;
+	}
+
+	std::pmr::vector<GLfloat> reordered(size_t(next) * floatsPerElement, 0.0f, scratch);
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		if (remap[v] != unused)
+			std::copy(verts + v * floatsPerElement, verts + (v + 1) * floatsPerElement,
+				reordered.begin() + size_t(remap[v]) * floatsPerElement);
+	}
+
+	std::copy(reordered.begin(), reordered.end(), verts);
+	return next;
+}
@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimize.h
+// ========
+// reorder indexed triangle meshes for the GPU: post-transform vertex cache
+// locality (Tipsify), overdraw, and vertex fetch locality
+//
+// All functions work on interleaved GLfloat vertex data and GL_TRIANGLES
+// GLuint indices, in place. Run them in the order declared below. Their
+// temporary arrays come from scratch, a MonotonicArena when rebuilding
+// meshes at runtime.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <memory_resource>
+#include <vector>
+
+namespace MeshOptimize
+{
+	// Number of entries in the simulated post-transform vertex cache
+	const GLuint defaultCacheSize = 16;
+
+	// Overdraw pass may give up this much ACMR (5%) to split clusters finer
+	const float defaultOverdrawThreshold = 1.05f;
+
+	float ACMR(const GLuint* indices, GLuint nIndices, GLuint nVertices, GLuint cacheSize = defaultCacheSize,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	void OptimizeVertexCache(GLuint* indices, GLuint nIndices, GLuint nVertices,
+		std::pmr::vector<GLuint>& clusters, GLuint cacheSize = defaultCacheSize,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+	void OptimizeOverdraw(GLuint* indices, GLuint nIndices, const GLfloat* verts, GLuint nVertices,
+		GLuint floatsPerElement, const std::pmr::vector<GLuint>& clusters,
+		GLuint cacheSize = defaultCacheSize, float threshold = defaultOverdrawThreshold,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+	GLuint OptimizeVertexFetch(GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+		GLuint* indices, GLuint nIndices,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+}
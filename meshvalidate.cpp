@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshvalidate.cpp
+// ========
+// winding checks for triangle meshes, so that back faces can be culled
+///////////////////////////////////////////////////////////////////////////////
+
+#include "meshvalidate.h"
+#include "primitives.h"
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace
+{
+	typedef std::tuple<long, long, long> Position;
+
+	// Generated seams meet at positions that differ in the last bits
+	const float weldScale = 1.0e5f;
+
+	std::uint64_t EdgeKey(GLuint from, GLuint to)
+	{
+		return (std::uint64_t(from) << 32) | to;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Consistent()
+//
+//	Every triangle agrees with its normals, and a closed mesh has no
+//	flipped edges and faces outward
+///////////////////////////////////////////////////
+bool MeshValidate::WindingReport::Consistent() const
+{
+	if (nAgainstNormals > 0 || nFlippedEdges > 0)
+		return false;
+	return !Closed() || signedVolume > 0.0f;
+}
+
+///////////////////////////////////////////////////
+//	CheckWinding(const GLfloat*, GLuint, GLuint, const GLuint*, GLuint, std::pmr::memory_resource*)
+//
+//	verts: interleaved vertices, position and normal at the Primitives offsets
+//	indices: GL_TRIANGLES indices
+///////////////////////////////////////////////////
+MeshValidate::WindingReport MeshValidate::CheckWinding(const GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+	const GLuint* indices, GLuint nIndices, std::pmr::memory_resource* scratch)
+{
+	WindingReport report;
+	report.nTriangles = nIndices / 3;
+
+	// one id per distinct position
+	std::pmr::map<Position, GLuint> positionIds(scratch);
+	std::pmr::vector<GLuint> welded(nVertices, 0, scratch);
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		const GLfloat* p = verts + v * floatsPerElement + Primitives::positionOffset;
+		welded[v] = positionIds.emplace(Position(std::lround(p[0] * weldScale), std::lround(p[1] * weldScale), std::lround(p[2] * weldScale)), GLuint(positionIds.size())).first->second;
+	}
+
+	std::pmr::unordered_map<std::uint64_t, GLuint> edgeCounts(nIndices, scratch);
+	double volume = 0.0;
+
+	for (GLuint t = 0; t < report.nTriangles; t++)
+	{
+		const GLuint* tri = indices + 3 * t;
+		const GLfloat* p0 = verts + tri[0] * floatsPerElement + Primitives::positionOffset;
+		const GLfloat* p1 = verts + tri[1] * floatsPerElement + Primitives::positionOffset;
+		const GLfloat* p2 = verts + tri[2] * floatsPerElement + Primitives::positionOffset;
+		const GLfloat* n0 = verts + tri[0] * floatsPerElement + Primitives::normalOffset;
+		const GLfloat* n1 = verts + tri[1] * floatsPerElement + Primitives::normalOffset;
+		const GLfloat* n2 = verts + tri[2] * floatsPerElement + Primitives::normalOffset;
+
+		GLuint w0 = welded[tri[0]];
+		GLuint w1 = welded[tri[1]];
+		GLuint w2 = welded[tri[2]];
+
+		double e1[3] = { double(p1[0]) - p0[0], double(p1[1]) - p0[1], double(p1[2]) - p0[2] };
+		double e2[3] = { double(p2[0]) - p0[0], double(p2[1]) - p0[1], double(p2[2]) - p0[2] };
+		double n[3] = {
+			e1[1] * e2[2] - e1[2] * e2[1],
+			e1[2] * e2[0] - e1[0] * e2[2],
+			e1[0] * e2[1] - e1[1] * e2[0]
+		};
+
+		if (w0 == w1 || w1 == w2 || w0 == w2 || (n[0] == 0.0 && n[1] == 0.0 && n[2] == 0.0))
+		{
+			report.nDegenerate++;
+			continue;
+		}
+
+		// compare against the sum of the authored vertex normals
+		double facing = 0.0;
+		for (int axis = 0; axis < 3; axis++)
+			facing += n[axis] * (double(n0[axis]) + n1[axis] + n2[axis]);
+		if (facing < 0.0)
+			report.nAgainstNormals++;
+
+		// divergence theorem: sum of signed tetrahedra to the origin
+		volume += (p0[0] * (double(p1[1]) * p2[2] - double(p1[2]) * p2[1])
+			+ p0[1] * (double(p1[2]) * p2[0] - double(p1[0]) * p2[2])
+			+ p0[2] * (double(p1[0]) * p2[1] - double(p1[1]) * p2[0])) / 6.0;
+
+		edgeCounts[EdgeKey(w0, w1)]++;
+		edgeCounts[EdgeKey(w1, w2)]++;
+		edgeCounts[EdgeKey(w2, w0)]++;
+	}
+
+	for (const auto& edge : edgeCounts)
+	{
+		GLuint from = GLuint(edge.first >> 32);
+		GLuint to = GLuint(edge.first & 0xffffffffu);
+
+		if (edge.second > 1)
+			report.nFlippedEdges += edge.second - 1;
+		if (edgeCounts.find(EdgeKey(to, from)) == edgeCounts.end())
+			report.nOpenEdges++;
+	}
+
+	report.signedVolume = float(volume);
+	return report;
+}
+
+///////////////////////////////////////////////////
+//	StripToTriangles(GLuint, GLuint, std::vector<GLuint>&)
+//
+//	firstVertex, nVertices: range passed to glDrawArrays
+//	indices: receives the triangles, degenerate ones included
+///////////////////////////////////////////////////
+void MeshValidate::StripToTriangles(GLuint firstVertex, GLuint nVertices, std::vector<GLuint>& indices)
+{
+	indices.clear();
+	for (GLuint i = 2; i < nVertices; i++)
+	{
+		GLuint v = firstVertex + i;
+		if (i % 2 == 0)
+			indices.insert(indices.end(), { v - 2, v - 1, v });
+		else
+			indices.insert(indices.end(), { v - 1, v - 2, v });
+	}
+}
@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshvalidate.h
+// ========
+// winding checks for triangle meshes, so that back faces can be culled
+//
+// A mesh passes when every triangle is counter-clockwise seen from the side
+// its vertex normals point to, and, for a closed mesh, every edge is shared
+// by exactly two triangles that traverse it in opposite directions with a
+// positive enclosed volume (outward facing).
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <memory_resource>
+#include <vector>
+
+namespace MeshValidate
+{
+	struct WindingReport
+	{
+		GLuint nTriangles = 0;
+		GLuint nDegenerate = 0;			// Zero area triangles, ignored by the other checks
+		GLuint nAgainstNormals = 0;		// Clockwise seen from the side the normals point to
+		GLuint nOpenEdges = 0;			// Edges used by one triangle only
+		GLuint nFlippedEdges = 0;		// Edges two triangles traverse in the same direction
+		float signedVolume = 0.0f;		// Positive when a closed mesh faces outward
+
+		bool Closed() const { return nOpenEdges == 0; }
+		bool Consistent() const;
+	};
+
+	// Vertices within 1e-5 of each other are treated as one when following
+	// edges, since flat shaded meshes and UV seams split them. Temporary
+	// tables come from scratch.
+	WindingReport CheckWinding(const GLfloat* verts, GLuint nVertices, GLuint floatsPerElement,
+		const GLuint* indices, GLuint nIndices,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+	// GL_TRIANGLE_STRIP order as GL_TRIANGLES indices, with GL's winding
+	// swap on every other triangle
+	void StripToTriangles(GLuint firstVertex, GLuint nVertices, std::vector<GLuint>& indices);
+}
@@ -0,0 +1,354 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipmaps.cpp
+// ========
+// mip chains built on the CPU, filtered in linear light with a windowed sinc
+///////////////////////////////////////////////////////////////////////////////
+
+#include "mipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAPS_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define MIPMAPS_AVX 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	// Output bytes each Downsample() task writes; small levels take one task
+	const std::size_t bandBytes = 256 * 1024;
+
+	// Texels are filtered as 4 floats whatever their channel count
+	const int lanes = 4;
+
+	const double pi = 3.14159265358979323846;
+
+	// Output texels the windowed sinc filters reach to either side
+	const double sincRadius = 3.0;
+
+	// Shape of the Kaiser window; larger is smoother and a little blurrier
+	const double kaiserAlpha = 4.0;
+
+	// 8 bit texels to floats in [0, 1] and back, through linear light for
+	// sRGB color. Encoding looks up linear values in steps of 1/65535,
+	// fine enough to round exactly even in the darks, where sRGB is steepest.
+	struct SrgbTables
+	{
+		float toUnit[256];
+		float toLinear[256];
+		unsigned char toSrgb[65536];
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				double encoded = i / 255.0;
+				toUnit[i] = float(encoded);
+				toLinear[i] = float(encoded <= 0.04045 ? encoded / 12.92 : std::pow((encoded + 0.055) / 1.055, 2.4));
+			}
+			for (int i = 0; i < 65536; i++)
+			{
+				double linear = i / 65535.0;
+				double encoded = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+				toSrgb[i] = (unsigned char)std::lround(encoded * 255.0);
+			}
+		}
+	};
+
+	const SrgbTables& Srgb()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	double Sinc(double x)
+	{
+		if (std::abs(x) < 1e-9)
+			return 1.0;
+		x *= pi;
+		return std::sin(x) / x;
+	}
+
+	// Modified Bessel function of the first kind, order 0, from its power series
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		double half = x * 0.5;
+		for (int k = 1; k < 64 && term > sum * 1e-12; k++)
+		{
+			term *= (half / k) * (half / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	// Output texels the filter reaches to either side
+	double Radius(Mipmaps::Filter filter)
+	{
+		return filter == Mipmaps::Filter::Box ? 0.5 : sincRadius;
+	}
+
+	// Weight of a texel t output texels from the center
+	double Weight(Mipmaps::Filter filter, double t)
+	{
+		t = std::abs(t);
+		switch (filter)
+		{
+		case Mipmaps::Filter::Box:
+			return t <= 0.5 ? 1.0 : 0.0;
+		case Mipmaps::Filter::Lanczos3:
+			return t < sincRadius ? Sinc(t) * Sinc(t / sincRadius) : 0.0;
+		default:
+		{
+			if (t >= sincRadius)
+				return 0.0;
+			double r = t / sincRadius;
+			return Sinc(t) * BesselI0(kaiserAlpha * std::sqrt(1.0 - r * r)) / BesselI0(kaiserAlpha);
+		}
+		}
+	}
+
+	// Source texels and weights of every output texel along one axis,
+	// count of them each; unused taps weigh 0
+	struct Taps
+	{
+		int count = 0;
+		std::vector<int> index;
+		std::vector<float> weight;
+	};
+
+	///////////////////////////////////////////////////
+	//	MakeTaps(int, int, const Options&)
+	//
+	//	Output texel x is centered on source coordinate (x + 0.5) * scale,
+	//	which also covers the odd sizes that do not halve exactly. Weights
+	//	are normalized, so flat areas stay flat.
+	///////////////////////////////////////////////////
+	Taps MakeTaps(int srcSize, int dstSize, const Mipmaps::Options& options)
+	{
+		double scale = double(srcSize) / dstSize;
+		double reach = Radius(options.filter) * scale;
+
+		Taps taps;
+		taps.count = int(std::ceil(2.0 * reach)) + 1;
+		taps.index.assign(std::size_t(dstSize) * taps.count, 0);
+		taps.weight.assign(std::size_t(dstSize) * taps.count, 0.0f);
+
+		std::vector<double> weights(taps.count);
+		for (int x = 0; x < dstSize; x++)
+		{
+			double center = (x + 0.5) * scale;
+			int first = int(std::ceil(center - reach - 0.5));
+			int last = int(std::floor(center + reach - 0.5));
+			int* index = &taps.index[std::size_t(x) * taps.count];
+			float* weight = &taps.weight[std::size_t(x) * taps.count];
+
+			int n = 0;
+			double sum = 0.0;
+			for (int i = first; i <= last && n < taps.count; i++, n++)
+			{
+				weights[n] = Weight(options.filter, (i + 0.5 - center) / scale);
+				sum += weights[n];
+				index[n] = options.wrap ? (i % srcSize + srcSize) % srcSize : std::clamp(i, 0, srcSize - 1);
+			}
+			for (int k = 0; k < n; k++)
+				weight[k] = float(sum > 0.0 ? weights[k] / sum : 1.0 / n);
+		}
+		return taps;
+	}
+
+	// Expand one row to 4 floats per texel, unused lanes 0
+	void DecodeRow(const unsigned char* src, int channels, int width, const float* const* decode, float* texels)
+	{
+		if (channels == lanes)
+		{
+			for (int x = 0; x < width; x++, src += lanes, texels += lanes)
+			{
+				texels[0] = decode[0][src[0]];
+				texels[1] = decode[1][src[1]];
+				texels[2] = decode[2][src[2]];
+				texels[3] = decode[3][src[3]];
+			}
+			return;
+		}
+
+		for (int x = 0; x < width; x++, src += channels, texels += lanes)
+		{
+			for (int c = 0; c < lanes; c++)
+				texels[c] = c < channels ? decode[c][src[c]] : 0.0f;
+		}
+	}
+
+	// Filter one row of texels across into dstWidth texels
+	void FilterAcross(const float* texels, const Taps& taps, int dstWidth, float* out)
+	{
+		for (int x = 0; x < dstWidth; x++, out += lanes)
+		{
+			const int* index = &taps.index[std::size_t(x) * taps.count];
+			const float* weight = &taps.weight[std::size_t(x) * taps.count];
+#ifdef MIPMAPS_SSE
+			__m128 sum = _mm_setzero_ps();
+			for (int k = 0; k < taps.count; k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(texels + std::size_t(index[k]) * lanes)));
+			_mm_storeu_ps(out, sum);
+#else
+			for (int c = 0; c < lanes; c++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < taps.count; k++)
+					sum += weight[k] * texels[std::size_t(index[k]) * lanes + c];
+				out[c] = sum;
+			}
+#endif
+		}
+	}
+
+	// sum += row * weight over n floats
+	void AddScaled(const float* row, float weight, float* sum, std::size_t n)
+	{
+		std::size_t i = 0;
+#ifdef MIPMAPS_AVX
+		const __m256 weight8 = _mm256_set1_ps(weight);
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(sum + i, _mm256_add_ps(_mm256_loadu_ps(sum + i), _mm256_mul_ps(weight8, _mm256_loadu_ps(row + i))));
+#endif
+#ifdef MIPMAPS_SSE
+		const __m128 weight4 = _mm_set1_ps(weight);
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(weight4, _mm_loadu_ps(row + i))));
+#endif
+		for (; i < n; i++)
+			sum[i] += row[i] * weight;
+	}
+
+	// Clamp filtered texels to [0, 1], overshoot from the negative lobes
+	// included, and round them back to 8 bits
+	void EncodeRow(const float* texels, int width, int channels, const bool* srgb, unsigned char* dst)
+	{
+		const unsigned char* toSrgb = Srgb().toSrgb;
+#ifdef MIPMAPS_SSE
+		const __m128 scale = _mm_setr_ps(srgb[0] ? 65535.0f : 255.0f, srgb[1] ? 65535.0f : 255.0f,
+			srgb[2] ? 65535.0f : 255.0f, srgb[3] ? 65535.0f : 255.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		alignas(16) std::int32_t quantized[lanes];
+		for (int x = 0; x < width; x++, texels += lanes, dst += channels)
+		{
+			__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(texels), zero), one);
+			_mm_store_si128(reinterpret_cast<__m128i*>(quantized), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half)));
+			for (int c = 0; c < channels; c++)
+				dst[c] = srgb[c] ? toSrgb[quantized[c]] : (unsigned char)quantized[c];
+		}
+#else
+		for (int x = 0; x < width; x++, texels += lanes, dst += channels)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				float value = std::min(std::max(texels[c], 0.0f), 1.0f);
+				dst[c] = srgb[c] ? toSrgb[int(value * 65535.0f + 0.5f)] : (unsigned char)int(value * 255.0f + 0.5f);
+			}
+		}
+#endif
+	}
+}
+
+std::size_t Mipmaps::ChainBytes(int width, int height, int channels)
+{
+	std::size_t bytes = 0;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		bytes += std::size_t(width) * height * channels;
+	}
+	return bytes;
+}
+
+///////////////////////////////////////////////////
+//	Downsample(const unsigned char*, int, int, int, unsigned char*, const Options&, ThreadPool&)
+//
+//	Each band filters across only the source rows its output rows reach,
+//	once each, then filters down from those. Neighbouring bands filter the
+//	rows they share twice, which costs less than waiting on each other.
+///////////////////////////////////////////////////
+void Mipmaps::Downsample(const unsigned char* src, int width, int height, int channels, unsigned char* dst,
+	const Options& options, ThreadPool& pool)
+{
+	int dstWidth = std::max(width / 2, 1);
+	int dstHeight = std::max(height / 2, 1);
+	Taps across = MakeTaps(width, dstWidth, options);
+	Taps down = MakeTaps(height, dstHeight, options);
+
+	// alpha, last of 2 and 4 channels, is never sRGB
+	const SrgbTables& tables = Srgb();
+	bool srgb[lanes];
+	const float* decode[lanes];
+	for (int c = 0; c < lanes; c++)
+	{
+		bool alpha = (channels == 2 || channels == 4) && c == channels - 1;
+		srgb[c] = options.srgb && c < channels && !alpha;
+		decode[c] = srgb[c] ? tables.toLinear : tables.toUnit;
+	}
+
+	std::size_t srcRowBytes = std::size_t(width) * channels;
+	std::size_t dstRowBytes = std::size_t(dstWidth) * channels;
+	std::size_t rowFloats = std::size_t(dstWidth) * lanes;
+	int bandRows = int(std::max<std::size_t>(bandBytes / dstRowBytes, 1));
+	std::size_t nBands = std::size_t((dstHeight + bandRows - 1) / bandRows);
+	pool.ParallelFor(nBands, [&](std::size_t band) {
+		int first = int(band) * bandRows;
+		int last = std::min(first + bandRows, dstHeight);
+
+		std::vector<int> rows(down.index.begin() + std::size_t(first) * down.count,
+			down.index.begin() + std::size_t(last) * down.count);
+		std::sort(rows.begin(), rows.end());
+		rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+		std::vector<float> texels(std::size_t(width) * lanes);
+		std::vector<float> filtered(rows.size() * rowFloats);
+		for (std::size_t r = 0; r < rows.size(); r++)
+		{
+			DecodeRow(src + std::size_t(rows[r]) * srcRowBytes, channels, width, decode, texels.data());
+			FilterAcross(texels.data(), across, dstWidth, filtered.data() + r * rowFloats);
+		}
+
+		std::vector<float> sum(rowFloats);
+		for (int y = first; y < last; y++)
+		{
+			std::fill(sum.begin(), sum.end(), 0.0f);
+			const int* index = &down.index[std::size_t(y) * down.count];
+			const float* weight = &down.weight[std::size_t(y) * down.count];
+			for (int k = 0; k < down.count; k++)
+			{
+				if (weight[k] == 0.0f)
+					continue;
+				std::size_t r = std::size_t(std::lower_bound(rows.begin(), rows.end(), index[k]) - rows.begin());
+				AddScaled(filtered.data() + r * rowFloats, weight[k], sum.data(), rowFloats);
+			}
+			EncodeRow(sum.data(), dstWidth, channels, srgb, dst + std::size_t(y) * dstRowBytes);
+		}
+	});
+}
+
+void Mipmaps::Generate(const unsigned char* level0, int width, int height, int channels, unsigned char* dst,
+	const Options& options, ThreadPool& pool)
+{
+	const unsigned char* src = level0;
+	while (width > 1 || height > 1)
+	{
+		Downsample(src, width, height, channels, dst, options, pool);
+		src = dst;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		dst += std::size_t(width) * height * channels;
+	}
+}
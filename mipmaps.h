@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipmaps.h
+// ========
+// mip chains built on the CPU, filtered in linear light with a windowed
+// sinc, in place of glGenerateMipmap's gamma space box filter
+//
+// Each level is halved from the one before with a separable filter: rows of
+// the source level are filtered across into float texels, then down. sRGB
+// color is decoded to linear before filtering and encoded again after;
+// alpha is filtered as it is. Output rows are split into bands run on the
+// pool, and the float work goes 4 or 8 lanes at a time with SSE or AVX.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "threadpool.h"
+
+#include <cstddef>
+
+namespace Mipmaps
+{
+	enum class Filter
+	{
+		Box,		// Average of the texels under each output texel, as glGenerateMipmap
+		Kaiser,		// Sinc windowed by a Kaiser window, 3 output texels each way
+		Lanczos3	// Sinc windowed by a wider sinc, 3 output texels each way; a little sharper, more ringing
+	};
+
+	struct Options
+	{
+		Filter filter = Filter::Kaiser;
+		bool srgb = true;	// Color channels are sRGB encoded; false for linear data such as normal maps
+		bool wrap = true;	// Filters wrap around the edges, as the GL_REPEAT every Samplers preset uses; false clamps
+	};
+
+	// Bytes of levels 1 and up of a full chain of 8 bit texels
+	std::size_t ChainBytes(int width, int height, int channels);
+
+	// Halve src, 1 to 4 channels of 8 bit texels, into dst, of
+	// max(width / 2, 1) by max(height / 2, 1) texels. Rows are tightly
+	// packed; 2 and 4 channel images have alpha last.
+	void Downsample(const unsigned char* src, int width, int height, int channels, unsigned char* dst,
+		const Options& options = Options(), ThreadPool& pool = ThreadPool::Shared());
+
+	// Build levels 1 and up of a full chain from level 0 into dst, each
+	// halved from the one before and packed after it, ChainBytes() in all
+	void Generate(const unsigned char* level0, int width, int height, int channels, unsigned char* dst,
+		const Options& options = Options(), ThreadPool& pool = ThreadPool::Shared());
+}
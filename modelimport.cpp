@@ -0,0 +1,913 @@
+///////////////////////////////////////////////////////////////////////////////
+// modelimport.cpp
+// ========
+// load Wavefront OBJ and glTF 2.0 (.gltf with .bin, or .glb) models into
+// meshes with the interleaved position, normal and texture coords layout
+// the built-in primitives use
+///////////////////////////////////////////////////////////////////////////////
+
+#include "modelimport.h"
+#include "json.h"
+#include "mappedfile.h"
+#include "meshbuilder.h"
+#include "meshnormals.h"
+#include "primitives.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	bool Fail(const char* path, const std::string& reason)
+	{
+		std::cout << "Failed to load model " << path << ": " << reason << std::endl;
+		return false;
+	}
+
+	// File name without directory or extension
+	std::string StemOf(const char* path)
+	{
+		std::string name(path);
+		std::size_t slash = name.find_last_of("/\\");
+		if (slash != std::string::npos)
+			name.erase(0, slash + 1);
+		std::size_t dot = name.find_last_of('.');
+		if (dot != std::string::npos && dot > 0)
+			name.erase(dot);
+		return name;
+	}
+
+	// Directory part of path with its trailing separator, or empty
+	std::string DirectoryOf(const char* path)
+	{
+		std::string directory(path);
+		std::size_t slash = directory.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : directory.substr(0, slash + 1);
+	}
+
+	// Lowercase extension including the dot
+	std::string ExtensionOf(const char* path)
+	{
+		std::string name(path);
+		std::size_t slash = name.find_last_of("/\\");
+		std::size_t dot = name.find_last_of('.');
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			return std::string();
+
+		std::string extension = name.substr(dot);
+		for (char& c : extension)
+			c = char(std::tolower((unsigned char)c));
+		return extension;
+	}
+
+	///////////////////////////////////////////////////
+	// OBJ
+	///////////////////////////////////////////////////
+
+	// OBJ text below this is parsed in one piece
+	const std::size_t minObjChunkBytes = 1 << 20;
+
+	// Chunks per pool thread, so that uneven chunks still keep every
+	// thread busy
+	const unsigned objChunksPerThread = 4;
+
+	// Welded vertices filled per task
+	const std::size_t objVerticesPerTask = 1 << 14;
+
+	// Face corner without texture coords or normal
+	const int noIndex = INT_MIN;
+
+	// v, vt and vn of one face corner, 0-based. An index written as
+	// negative in the file is relative to the chunk's own elements until
+	// every chunk has been counted; relative has bit k set for those.
+	struct ObjCorner
+	{
+		int index[3];
+		unsigned char relative;
+	};
+
+	struct ObjChunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+		std::vector<float> elements[3];		// Positions, texture coords, normals
+		std::vector<ObjCorner> corners;		// Three per triangle
+		std::size_t nLines = 0;
+		std::size_t errorLine = 0;			// Line of the first error within the chunk, from 1
+	};
+
+	// floats in each of elements
+	const std::size_t objElementSize[3] = { 3, 2, 3 };
+
+	// Slot hash of a v/vt/vn triple
+	std::size_t HashCorner(const int* key)
+	{
+		std::uint64_t hash = (std::uint64_t(std::uint32_t(key[0])) * 0x9E3779B97F4A7C15ull)
+			^ (std::uint64_t(std::uint32_t(key[1])) * 0xC2B2AE3D27D4EB4Full)
+			^ (std::uint64_t(std::uint32_t(key[2])) * 0x165667B19E3779F9ull);
+		return std::size_t(hash >> 32);
+	}
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpace(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+			p++;
+		return p;
+	}
+
+	bool AtLineEnd(const char* p, const char* end)
+	{
+		return p == end || *p == '\n' || *p == '#';
+	}
+
+	// Read up to nMax floats, at least nRequired; the rest are zeroed
+	bool ParseFloats(const char*& p, const char* end, float* values, int nRequired, int nMax)
+	{
+		int n = 0;
+		for (; n < nMax; n++)
+		{
+			p = SkipSpace(p, end);
+			if (AtLineEnd(p, end))
+				break;
+
+			// from_chars does not take a leading '+'
+			if (*p == '+')
+				p++;
+			std::from_chars_result result = std::from_chars(p, end, values[n]);
+			if (result.ec != std::errc())
+				return false;
+			p = result.ptr;
+		}
+
+		for (int i = n; i < nMax; i++)
+			values[i] = 0.0f;
+		return n >= nRequired;
+	}
+
+	// One face corner: v, v/vt, v//vn or v/vt/vn. counts are the elements
+	// of each kind seen so far in the chunk.
+	bool ParseCorner(const char*& p, const char* end, const std::size_t counts[3], ObjCorner& corner)
+	{
+		int values[3] = { noIndex, noIndex, noIndex };
+		for (int k = 0; k < 3; k++)
+		{
+			if (k > 0)
+			{
+				if (p == end || *p != '/')
+					break;
+				p++;
+				if (p < end && *p == '/')
+					continue;
+			}
+
+			std::from_chars_result result = std::from_chars(p, end, values[k]);
+			if (result.ec != std::errc() || values[k] == 0)
+				return false;
+			p = result.ptr;
+		}
+
+		if (p < end && !IsSpace(*p) && *p != '\n')
+			return false;
+
+		corner.relative = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			if (values[k] == noIndex)
+				corner.index[k] = noIndex;
+			else if (values[k] > 0)
+				corner.index[k] = values[k] - 1;
+			else
+			{
+				corner.index[k] = int(counts[k]) + values[k];
+				corner.relative |= (unsigned char)(1 << k);
+			}
+		}
+		return true;
+	}
+
+	void ParseObjChunk(ObjChunk& chunk)
+	{
+		const char* end = chunk.end;
+		std::size_t counts[3] = { 0, 0, 0 };
+
+		for (const char* p = chunk.begin; p < end; chunk.nLines++)
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+			lineEnd = lineEnd ? lineEnd + 1 : end;
+
+			p = SkipSpace(p, end);
+			bool parsed = true;
+
+			// v, vt and vn add one element of their kind
+			int kind = -1;
+			if (p + 1 < end && p[0] == 'v' && IsSpace(p[1]))
+				kind = 0;
+			else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && IsSpace(p[2]))
+				kind = 1;
+			else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && IsSpace(p[2]))
+				kind = 2;
+
+			if (kind >= 0)
+			{
+				float values[3];
+				int size = int(objElementSize[kind]);
+				p += kind == 0 ? 1 : 2;
+				// a vt may leave out v
+				parsed = ParseFloats(p, end, values, kind == 1 ? 1 : size, size);
+				chunk.elements[kind].insert(chunk.elements[kind].end(), values, values + size);
+				counts[kind]++;
+			}
+			else if (p + 1 < end && p[0] == 'f' && IsSpace(p[1]))
+			{
+				// fan the polygon from its first corner
+				ObjCorner first, previous, corner;
+				int nCorners = 0;
+				p++;
+				for (;;)
+				{
+					p = SkipSpace(p, end);
+					if (AtLineEnd(p, end))
+						break;
+					if (!ParseCorner(p, end, counts, corner))
+					{
+						parsed = false;
+						break;
+					}
+
+					if (nCorners == 0)
+						first = corner;
+					else if (nCorners >= 2)
+					{
+						chunk.corners.push_back(first);
+						chunk.corners.push_back(previous);
+						chunk.corners.push_back(corner);
+					}
+					previous = corner;
+					nCorners++;
+				}
+			}
+			// comments, groups, smoothing groups, materials, lines and
+			// points do not change the geometry
+
+			if (!parsed)
+			{
+				chunk.errorLine = chunk.nLines + 1;
+				return;
+			}
+			p = lineEnd;
+		}
+	}
+
+	///////////////////////////////////////////////////
+	// glTF
+	///////////////////////////////////////////////////
+
+	const int gltfUnsignedByte = 5121;
+	const int gltfUnsignedShort = 5123;
+	const int gltfUnsignedInt = 5125;
+	const int gltfFloat = 5126;
+	const int gltfTriangles = 4;
+
+	const std::uint32_t glbMagic = 0x46546C67;		// "glTF"
+	const std::uint32_t glbJsonChunk = 0x4E4F534A;	// "JSON"
+	const std::uint32_t glbBinChunk = 0x004E4942;	// "BIN\0"
+
+	struct Span
+	{
+		const unsigned char* data = nullptr;
+		std::size_t size = 0;
+	};
+
+	// Strided view of an accessor's elements inside a buffer
+	struct Accessor
+	{
+		const unsigned char* data = nullptr;
+		std::size_t count = 0;
+		std::size_t stride = 0;
+		int componentType = 0;
+		int nComponents = 0;
+		bool normalized = false;
+	};
+
+	// Attributes and indices of one GL_TRIANGLES primitive
+	struct GltfPrimitive
+	{
+		Accessor positions;
+		Accessor normals;
+		Accessor uvs;
+		Accessor indices;
+		bool hasNormals = false;
+		bool hasUVs = false;
+		bool hasIndices = false;
+		Meshes::MeshData* data = nullptr;
+	};
+
+	std::uint32_t ReadU32(const unsigned char* p)
+	{
+		std::uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	std::size_t ComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case 5120:
+		case gltfUnsignedByte:
+			return 1;
+		case 5122:
+		case gltfUnsignedShort:
+			return 2;
+		case gltfUnsignedInt:
+		case gltfFloat:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+	int ComponentCount(std::string_view type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		if (type == "VEC2")
+			return 2;
+		if (type == "VEC3")
+			return 3;
+		if (type == "VEC4")
+			return 4;
+		return 0;
+	}
+
+	// Index held by value, or npos when it is not a non-negative number
+	std::size_t IndexOf(const Json::Document& document, std::size_t value)
+	{
+		double number = document.Number(value, -1.0);
+		return number >= 0.0 ? std::size_t(number) : Json::Document::npos;
+	}
+
+	// Component c of element i as a float; normalized unsigned integers map
+	// to [0, 1]
+	float ReadFloat(const Accessor& accessor, std::size_t i, int c)
+	{
+		const unsigned char* p = accessor.data + i * accessor.stride;
+		switch (accessor.componentType)
+		{
+		case gltfUnsignedByte:
+			return p[c] / 255.0f;
+		case gltfUnsignedShort:
+		{
+			std::uint16_t value;
+			std::memcpy(&value, p + 2 * c, sizeof(value));
+			return value / 65535.0f;
+		}
+		default:
+		{
+			float value;
+			std::memcpy(&value, p + 4 * c, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	GLuint ReadIndex(const Accessor& accessor, std::size_t i)
+	{
+		const unsigned char* p = accessor.data + i * accessor.stride;
+		switch (accessor.componentType)
+		{
+		case gltfUnsignedByte:
+			return *p;
+		case gltfUnsignedShort:
+		{
+			std::uint16_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+		default:
+			return ReadU32(p);
+		}
+	}
+
+	bool ResolveAccessor(const Json::Document& document, const std::vector<Span>& buffers, std::size_t index,
+		Accessor& accessor, std::string& error)
+	{
+		const std::size_t root = Json::Document::root;
+		std::size_t node = document.Element(document.Member(root, "accessors"), index);
+		if (node == Json::Document::npos)
+		{
+			error = "missing accessor " + std::to_string(index);
+			return false;
+		}
+
+		std::size_t view = document.Element(document.Member(root, "bufferViews"), IndexOf(document, document.Member(node, "bufferView")));
+		if (view == Json::Document::npos || document.Member(node, "sparse") != Json::Document::npos)
+		{
+			error = "accessor " + std::to_string(index) + " has no buffer view or is sparse";
+			return false;
+		}
+
+		accessor.componentType = int(document.Number(document.Member(node, "componentType"), 0.0));
+		accessor.nComponents = ComponentCount(document.String(document.Member(node, "type")));
+		accessor.normalized = document.Bool(document.Member(node, "normalized"), false);
+		accessor.count = std::size_t(std::max(0.0, document.Number(document.Member(node, "count"), 0.0)));
+
+		std::size_t elementSize = ComponentSize(accessor.componentType) * std::size_t(accessor.nComponents);
+		std::size_t buffer = IndexOf(document, document.Member(view, "buffer"));
+		std::size_t viewOffset = std::size_t(std::max(0.0, document.Number(document.Member(view, "byteOffset"), 0.0)));
+		std::size_t viewLength = std::size_t(std::max(0.0, document.Number(document.Member(view, "byteLength"), 0.0)));
+		std::size_t offset = std::size_t(std::max(0.0, document.Number(document.Member(node, "byteOffset"), 0.0)));
+		accessor.stride = std::size_t(std::max(0.0, document.Number(document.Member(view, "byteStride"), 0.0)));
+		if (accessor.stride == 0)
+			accessor.stride = elementSize;
+
+		std::size_t span = accessor.count > 0 ? offset + (accessor.count - 1) * accessor.stride + elementSize : 0;
+		if (elementSize == 0 || buffer >= buffers.size()
+			|| viewOffset > buffers[buffer].size || viewLength > buffers[buffer].size - viewOffset || span > viewLength)
+		{
+			error = "accessor " + std::to_string(index) + " does not fit its buffer";
+			return false;
+		}
+
+		accessor.data = buffers[buffer].data + viewOffset + offset;
+		return true;
+	}
+
+	bool DecodeBase64(std::string_view text, std::vector<unsigned char>& bytes)
+	{
+		bytes.clear();
+		bytes.reserve(text.size() / 4 * 3);
+
+		std::uint32_t bits = 0;
+		int nBits = 0;
+		for (char c : text)
+		{
+			int value;
+			if (c >= 'A' && c <= 'Z')
+				value = c - 'A';
+			else if (c >= 'a' && c <= 'z')
+				value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9')
+				value = c - '0' + 52;
+			else if (c == '+')
+				value = 62;
+			else if (c == '/')
+				value = 63;
+			else if (c == '=')
+				break;
+			else
+				return false;
+
+			bits = (bits << 6) | std::uint32_t(value);
+			nBits += 6;
+			if (nBits >= 8)
+			{
+				nBits -= 8;
+				bytes.push_back((unsigned char)(bits >> nBits));
+			}
+		}
+		return true;
+	}
+
+	// %XX escapes in a relative URI
+	std::string DecodeUri(std::string_view uri)
+	{
+		std::string decoded;
+		decoded.reserve(uri.size());
+		for (std::size_t i = 0; i < uri.size(); i++)
+		{
+			int value = 0;
+			if (uri[i] == '%' && i + 2 < uri.size()
+				&& std::from_chars(uri.data() + i + 1, uri.data() + i + 3, value, 16).ptr == uri.data() + i + 3)
+			{
+				decoded.push_back(char(value));
+				i += 2;
+			}
+			else
+				decoded.push_back(uri[i]);
+		}
+		return decoded;
+	}
+
+	// Copy one primitive into its mesh; runs on the pool
+	bool DecodePrimitive(const GltfPrimitive& primitive)
+	{
+		Meshes::MeshData& data = *primitive.data;
+		GLuint nVertices = GLuint(primitive.positions.count);
+		GLuint nIndices = primitive.hasIndices ? GLuint(primitive.indices.count) : nVertices;
+
+		MeshBuilder builder(data.arena, nVertices, nIndices);
+		GLfloat* verts = builder.Vertices();
+		GLuint* indices = builder.Indices();
+
+		for (GLuint v = 0; v < nVertices; v++)
+		{
+			GLfloat* vertex = verts + std::size_t(v) * Primitives::floatsPerElement;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				vertex[Primitives::positionOffset + axis] = ReadFloat(primitive.positions, v, axis);
+				vertex[Primitives::normalOffset + axis] = primitive.hasNormals ? ReadFloat(primitive.normals, v, axis) : 0.0f;
+			}
+
+			// glTF puts v = 0 at the top of the image
+			vertex[Primitives::uvOffset + 0] = primitive.hasUVs ? ReadFloat(primitive.uvs, v, 0) : 0.0f;
+			vertex[Primitives::uvOffset + 1] = primitive.hasUVs ? 1.0f - ReadFloat(primitive.uvs, v, 1) : 0.0f;
+		}
+
+		for (GLuint i = 0; i < nIndices; i++)
+		{
+			indices[i] = primitive.hasIndices ? ReadIndex(primitive.indices, i) : i;
+			if (indices[i] >= nVertices)
+				return false;
+		}
+		builder.MarkFull();
+
+		if (!primitive.hasNormals)
+			MeshNormals::GenerateNormals(verts, nVertices, Primitives::floatsPerElement, indices, nIndices, &data.arena);
+
+		data.verts = verts;
+		data.nVertices = nVertices;
+		data.indices = indices;
+		data.nIndices = nIndices;
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////
+//	Load(const char*, Model&, ThreadPool&)
+//
+//	path: .obj, .gltf or .glb file
+//	model: receives the meshes; left empty on failure
+///////////////////////////////////////////////////
+bool ModelImport::Load(const char* path, Model& model, ThreadPool& pool)
+{
+	std::string extension = ExtensionOf(path);
+	if (extension == ".obj")
+		return LoadObj(path, model, pool);
+	if (extension == ".gltf" || extension == ".glb")
+		return LoadGltf(path, model, pool);
+	return Fail(path, "unknown model format");
+}
+
+///////////////////////////////////////////////////
+//	LoadObj(const char*, Model&, ThreadPool&)
+//
+//	Parse line-aligned chunks of the mapped text on the pool, then join
+//	them: resolve relative indices, weld identical v/vt/vn corners into
+//	one vertex, and fill the vertices on the pool again
+///////////////////////////////////////////////////
+bool ModelImport::LoadObj(const char* path, Model& model, ThreadPool& pool)
+{
+	model.names.clear();
+	model.meshes.clear();
+
+	MappedFile file;
+	if (!file.Open(path))
+		return Fail(path, "cannot open file");
+
+	const char* text = reinterpret_cast<const char*>(file.Data());
+	std::size_t size = file.Size();
+
+	// cut at the first line break after each even split
+	std::size_t nChunks = std::max<std::size_t>(1, std::min<std::size_t>(size / minObjChunkBytes, pool.ThreadCount() * objChunksPerThread));
+	std::vector<ObjChunk> chunks(nChunks);
+	const char* cut = text;
+	for (std::size_t c = 0; c < nChunks; c++)
+	{
+		const char* end = text + size * (c + 1) / nChunks;
+		if (end < cut)
+			end = cut;
+		const char* lineBreak = c + 1 < nChunks ? static_cast<const char*>(std::memchr(end, '\n', std::size_t(text + size - end))) : nullptr;
+		end = lineBreak ? lineBreak + 1 : text + size;
+
+		chunks[c].begin = cut;
+		chunks[c].end = end;
+		cut = end;
+	}
+
+	pool.ParallelFor(nChunks, [&chunks](std::size_t c) { ParseObjChunk(chunks[c]); });
+
+	// first element of each kind in every chunk
+	std::vector<std::size_t> bases[3];
+	std::size_t totals[3] = { 0, 0, 0 };
+	std::size_t nCorners = 0;
+	std::size_t line = 0;
+	for (const ObjChunk& chunk : chunks)
+	{
+		if (chunk.errorLine)
+			return Fail(path, "syntax error on line " + std::to_string(line + chunk.errorLine));
+		line += chunk.nLines;
+
+		for (int k = 0; k < 3; k++)
+		{
+			bases[k].push_back(totals[k]);
+			totals[k] += chunk.elements[k].size() / objElementSize[k];
+		}
+		nCorners += chunk.corners.size();
+	}
+
+	if (nCorners == 0)
+		return Fail(path, "no faces");
+	if (nCorners > std::size_t(INT_MAX) || totals[0] > std::size_t(INT_MAX))
+		return Fail(path, "too large");
+
+	// make every index absolute and check it
+	std::vector<char> chunkValid(nChunks, 1);
+	pool.ParallelFor(nChunks, [&](std::size_t c) {
+		for (ObjCorner& corner : chunks[c].corners)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				if (corner.index[k] == noIndex)
+					continue;
+				if (corner.relative & (1 << k))
+					corner.index[k] += int(bases[k][c]);
+				if (corner.index[k] < 0 || std::size_t(corner.index[k]) >= totals[k])
+					chunkValid[c] = 0;
+			}
+		}
+	});
+	if (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end())
+		return Fail(path, "face index out of range");
+
+	std::unique_ptr<Meshes::MeshData> data(new Meshes::MeshData());
+	MonotonicArena& arena = data->arena;
+	GLuint* indices = arena.Allocate<GLuint>(nCorners);
+
+	// weld corners with the same v/vt/vn: open addressing over indices
+	// into keys, grown at half full
+	const GLuint empty = ~0u;
+	std::vector<int> keys;
+	std::vector<GLuint> table(std::size_t(1) << 16, empty);
+	std::size_t mask = table.size() - 1;
+	bool missingNormals = false;
+	GLuint nVertices = 0;
+
+	std::size_t corner = 0;
+	for (const ObjChunk& chunk : chunks)
+	{
+		for (const ObjCorner& objCorner : chunk.corners)
+		{
+			const int* key = objCorner.index;
+			missingNormals |= key[2] == noIndex;
+
+			std::size_t slot = HashCorner(key) & mask;
+			for (;;)
+			{
+				GLuint vertex = table[slot];
+				if (vertex == empty)
+				{
+					table[slot] = nVertices;
+					keys.insert(keys.end(), key, key + 3);
+					vertex = nVertices++;
+				}
+				else if (std::memcmp(&keys[std::size_t(vertex) * 3], key, sizeof(int) * 3) != 0)
+				{
+					slot = (slot + 1) & mask;
+					continue;
+				}
+				indices[corner++] = vertex;
+				break;
+			}
+
+			if (std::size_t(nVertices) * 2 > table.size())
+			{
+				table.assign(table.size() * 2, empty);
+				mask = table.size() - 1;
+				for (GLuint v = 0; v < nVertices; v++)
+				{
+					const int* existing = &keys[std::size_t(v) * 3];
+					std::size_t free = HashCorner(existing) & mask;
+					while (table[free] != empty)
+						free = (free + 1) & mask;
+					table[free] = v;
+				}
+			}
+		}
+	}
+	std::vector<GLuint>().swap(table);
+
+	// element i of kind k, found in the chunk holding it
+	auto element = [&](int k, int i) -> const float* {
+		std::size_t c = std::size_t(std::upper_bound(bases[k].begin(), bases[k].end(), std::size_t(i)) - bases[k].begin()) - 1;
+		return chunks[c].elements[k].data() + (std::size_t(i) - bases[k][c]) * objElementSize[k];
+	};
+
+	GLfloat* verts = arena.Allocate<GLfloat>(std::size_t(nVertices) * Primitives::floatsPerElement);
+	std::size_t nVertexTasks = (std::size_t(nVertices) + objVerticesPerTask - 1) / objVerticesPerTask;
+	pool.ParallelFor(nVertexTasks, [&](std::size_t task) {
+		std::size_t end = std::min<std::size_t>(nVertices, (task + 1) * objVerticesPerTask);
+		for (std::size_t v = task * objVerticesPerTask; v < end; v++)
+		{
+			const int* key = &keys[v * 3];
+			GLfloat* vertex = verts + v * Primitives::floatsPerElement;
+			std::fill(vertex, vertex + Primitives::floatsPerElement, 0.0f);
+			std::copy(element(0, key[0]), element(0, key[0]) + 3, vertex + Primitives::positionOffset);
+			if (key[2] != noIndex)
+				std::copy(element(2, key[2]), element(2, key[2]) + 3, vertex + Primitives::normalOffset);
+			if (key[1] != noIndex)
+				std::copy(element(1, key[1]), element(1, key[1]) + 2, vertex + Primitives::uvOffset);
+		}
+	});
+
+	if (missingNormals)
+		MeshNormals::GenerateNormals(verts, nVertices, Primitives::floatsPerElement, indices, GLuint(nCorners), &arena);
+
+	data->verts = verts;
+	data->nVertices = nVertices;
+	data->indices = indices;
+	data->nIndices = GLuint(nCorners);
+
+	model.names.push_back(StemOf(path));
+	model.meshes.push_back(std::move(data));
+	model.meshes[0]->name = model.names[0].c_str();
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	LoadGltf(const char*, Model&, ThreadPool&)
+//
+//	Parse the JSON in place, map the external buffers, then decode every
+//	GL_TRIANGLES primitive into its own mesh on the pool
+///////////////////////////////////////////////////
+bool ModelImport::LoadGltf(const char* path, Model& model, ThreadPool& pool)
+{
+	model.names.clear();
+	model.meshes.clear();
+
+	// leave nothing half loaded behind
+	auto fail = [&](const std::string& reason) {
+		model.names.clear();
+		model.meshes.clear();
+		return Fail(path, reason);
+	};
+
+	MappedFile file;
+	if (!file.Open(path))
+		return fail("cannot open file");
+
+	const unsigned char* bytes = file.Data();
+	const char* json = reinterpret_cast<const char*>(bytes);
+	std::size_t jsonSize = file.Size();
+	Span glbBin;
+
+	// binary container: 12 byte header, then JSON and BIN chunks
+	if (file.Size() >= 12 && ReadU32(bytes) == glbMagic)
+	{
+		std::size_t length = ReadU32(bytes + 8);
+		if (ReadU32(bytes + 4) != 2 || length > file.Size())
+			return fail("unsupported or truncated GLB");
+
+		json = nullptr;
+		for (std::size_t offset = 12; offset + 8 <= length;)
+		{
+			std::size_t chunkLength = ReadU32(bytes + offset);
+			std::uint32_t chunkType = ReadU32(bytes + offset + 4);
+			if (chunkLength > length - offset - 8)
+				return fail("truncated GLB chunk");
+
+			if (chunkType == glbJsonChunk && !json)
+			{
+				json = reinterpret_cast<const char*>(bytes + offset + 8);
+				jsonSize = chunkLength;
+			}
+			else if (chunkType == glbBinChunk && !glbBin.data)
+			{
+				glbBin.data = bytes + offset + 8;
+				glbBin.size = chunkLength;
+			}
+			offset += 8 + chunkLength;
+		}
+
+		if (!json)
+			return fail("GLB without JSON chunk");
+	}
+
+	Json::Document document;
+	if (!document.Parse(json, jsonSize))
+		return fail(document.Error());
+
+	const std::size_t root = Json::Document::root;
+	if (document.String(document.Member(document.Member(root, "asset"), "version")).substr(0, 2) != "2.")
+		return fail("not glTF 2.0");
+
+	// external buffers are mapped, embedded ones decoded
+	std::string directory = DirectoryOf(path);
+	std::size_t bufferList = document.Member(root, "buffers");
+	std::vector<Span> buffers(document.Size(bufferList));
+	std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+	std::vector<std::vector<unsigned char>> decodedBuffers;
+	for (std::size_t b = 0; b < buffers.size(); b++)
+	{
+		std::size_t buffer = document.Element(bufferList, b);
+		std::size_t byteLength = std::size_t(std::max(0.0, document.Number(document.Member(buffer, "byteLength"), 0.0)));
+		std::string_view uri = document.String(document.Member(buffer, "uri"));
+
+		if (uri.empty())
+		{
+			if (b != 0 || !glbBin.data)
+				return fail("buffer " + std::to_string(b) + " has no uri");
+			buffers[b] = glbBin;
+		}
+		else if (uri.substr(0, 5) == "data:")
+		{
+			std::size_t base64 = uri.find(";base64,");
+			decodedBuffers.emplace_back();
+			if (base64 == std::string_view::npos || !DecodeBase64(uri.substr(base64 + 8), decodedBuffers.back()))
+				return fail("buffer " + std::to_string(b) + " has an unsupported data uri");
+			buffers[b].data = decodedBuffers.back().data();
+			buffers[b].size = decodedBuffers.back().size();
+		}
+		else
+		{
+			std::string bufferPath = directory + DecodeUri(uri);
+			bufferFiles.emplace_back(new MappedFile());
+			if (!bufferFiles.back()->Open(bufferPath.c_str()))
+				return fail("cannot open buffer " + bufferPath);
+			buffers[b].data = bufferFiles.back()->Data();
+			buffers[b].size = bufferFiles.back()->Size();
+		}
+
+		if (buffers[b].size < byteLength)
+			return fail("buffer " + std::to_string(b) + " is shorter than its byteLength");
+	}
+
+	// check every primitive here, so the jobs only copy
+	std::vector<GltfPrimitive> primitives;
+	std::string error;
+	std::size_t meshList = document.Member(root, "meshes");
+	for (std::size_t m = 0; m < document.Size(meshList); m++)
+	{
+		std::size_t mesh = document.Element(meshList, m);
+		std::size_t primitiveList = document.Member(mesh, "primitives");
+		std::string meshName(document.String(document.Member(mesh, "name")));
+		if (meshName.empty())
+			meshName = "mesh" + std::to_string(m);
+
+		for (std::size_t p = 0; p < document.Size(primitiveList); p++)
+		{
+			std::size_t node = document.Element(primitiveList, p);
+			if (document.Number(document.Member(node, "mode"), gltfTriangles) != gltfTriangles)
+			{
+				std::cout << "WARNING: Model " << path << " " << meshName << " primitive " << p << " is not GL_TRIANGLES, skipped" << std::endl;
+				continue;
+			}
+
+			std::size_t attributes = document.Member(node, "attributes");
+			std::size_t position = document.Member(attributes, "POSITION");
+			std::size_t normal = document.Member(attributes, "NORMAL");
+			std::size_t uv = document.Member(attributes, "TEXCOORD_0");
+			std::size_t indices = document.Member(node, "indices");
+
+			GltfPrimitive primitive;
+			primitive.hasNormals = normal != Json::Document::npos;
+			primitive.hasUVs = uv != Json::Document::npos;
+			primitive.hasIndices = indices != Json::Document::npos;
+
+			if (!ResolveAccessor(document, buffers, IndexOf(document, position), primitive.positions, error)
+				|| (primitive.hasNormals && !ResolveAccessor(document, buffers, IndexOf(document, normal), primitive.normals, error))
+				|| (primitive.hasUVs && !ResolveAccessor(document, buffers, IndexOf(document, uv), primitive.uvs, error))
+				|| (primitive.hasIndices && !ResolveAccessor(document, buffers, IndexOf(document, indices), primitive.indices, error)))
+				return fail(error);
+
+			std::size_t nVertices = primitive.positions.count;
+			bool uvType = primitive.uvs.componentType == gltfFloat
+				|| (primitive.uvs.normalized && (primitive.uvs.componentType == gltfUnsignedByte || primitive.uvs.componentType == gltfUnsignedShort));
+			bool indexType = primitive.indices.componentType == gltfUnsignedByte || primitive.indices.componentType == gltfUnsignedShort
+				|| primitive.indices.componentType == gltfUnsignedInt;
+			std::size_t nIndices = primitive.hasIndices ? primitive.indices.count : nVertices;
+
+			if (primitive.positions.componentType != gltfFloat || primitive.positions.nComponents != 3
+				|| (primitive.hasNormals && (primitive.normals.componentType != gltfFloat || primitive.normals.nComponents != 3 || primitive.normals.count != nVertices))
+				|| (primitive.hasUVs && (!uvType || primitive.uvs.nComponents != 2 || primitive.uvs.count != nVertices))
+				|| (primitive.hasIndices && (!indexType || primitive.indices.nComponents != 1))
+				|| nIndices % 3 != 0 || nVertices > std::size_t(UINT_MAX) || nIndices > std::size_t(UINT_MAX))
+				return fail(meshName + " primitive " + std::to_string(p) + " has unsupported attribute formats");
+
+			model.names.push_back(document.Size(primitiveList) > 1 ? meshName + "/" + std::to_string(p) : meshName);
+			model.meshes.emplace_back(new Meshes::MeshData());
+			primitive.data = model.meshes.back().get();
+			primitives.push_back(primitive);
+		}
+	}
+
+	std::vector<char> decoded(primitives.size(), 0);
+	pool.ParallelFor(primitives.size(), [&](std::size_t p) { decoded[p] = DecodePrimitive(primitives[p]); });
+	if (std::find(decoded.begin(), decoded.end(), 0) != decoded.end())
+		return fail("index out of range");
+
+	// names no longer move
+	for (std::size_t i = 0; i < model.meshes.size(); i++)
+		model.meshes[i]->name = model.names[i].c_str();
+	return true;
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// modelimport.h
+// ========
+// load Wavefront OBJ and glTF 2.0 (.gltf with .bin, or .glb) models into
+// meshes with the interleaved position, normal and texture coords layout
+// the built-in primitives use
+//
+// Files are memory-mapped and parsed in place. OBJ text is split into
+// line-aligned chunks parsed in parallel; glTF primitives are decoded in
+// parallel. Texture coords follow the OpenGL convention (v up), so glTF's
+// are flipped. Node transforms, materials and skins are not imported.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "meshes.h"
+#include "threadpool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ModelImport
+{
+	// Meshes of one model file, in file order, not yet optimized
+	struct Model
+	{
+		std::vector<std::string> names;		// One per mesh; MeshData::name points into these
+		std::vector<std::unique_ptr<Meshes::MeshData>> meshes;
+	};
+
+	// Pick the loader from the file extension. Work is split with
+	// ThreadPool::ParallelFor(), so it may be called from a job on pool.
+	bool Load(const char* path, Model& model, ThreadPool& pool = ThreadPool::Shared());
+
+	// One mesh for the whole file, named after it. Polygons are fanned
+	// into triangles; normals are generated when the file has none.
+	bool LoadObj(const char* path, Model& model, ThreadPool& pool = ThreadPool::Shared());
+
+	// One mesh per GL_TRIANGLES primitive, named "<mesh>" or
+	// "<mesh>/<primitive>". Normals are generated for primitives without.
+	bool LoadGltf(const char* path, Model& model, ThreadPool& pool = ThreadPool::Shared());
+}
@@ -0,0 +1,417 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitives.cpp
+// ========
+// parametric generators for 3D primitives: revolved profiles (cylinder, cone,
+// tapered cylinder), UV sphere, icosphere and torus
+///////////////////////////////////////////////////////////////////////////////
+
+#include "primitives.h"
+
+#include <cmath>
+
+namespace
+{
+	const float PI = 3.14159265358979323846f;
+	const float TWO_PI = 2.0f * PI;
+
+	// write one interleaved vertex and return the position after it
+	GLfloat* WriteVertex(GLfloat* out, float x, float y, float z, float nx, float ny, float nz, float u, float v)
+	{
+		out[Primitives::positionOffset + 0] = x;
+		out[Primitives::positionOffset + 1] = y;
+		out[Primitives::positionOffset + 2] = z;
+		out[Primitives::normalOffset + 0] = nx;
+		out[Primitives::normalOffset + 1] = ny;
+		out[Primitives::normalOffset + 2] = nz;
+		out[Primitives::uvOffset + 0] = u;
+		out[Primitives::uvOffset + 1] = v;
+		return out + Primitives::floatsPerElement;
+	}
+
+	// write one triangle and return the position after it
+	GLuint* WriteTriangle(GLuint* out, GLuint a, GLuint b, GLuint c)
+	{
+		out[0] = a;
+		out[1] = b;
+		out[2] = c;
+		return out + 3;
+	}
+
+	// Outward unit normal of profile edge k in the (radius, y) plane. A
+	// zero length edge, from a repeated point, takes the normal of the
+	// nearest edge that has a length, or points straight out if none does.
+	void EdgeNormal(const Primitives::ProfilePoint* profile, GLuint nProfile, GLuint k, float& nr, float& ny)
+	{
+		for (GLuint distance = 0; distance + 1 < nProfile; distance++)
+		{
+			for (int side = 0; side < 2; side++)
+			{
+				GLint edge = side == 0 ? GLint(k + distance) : GLint(k) - GLint(distance);
+				if (edge < 0 || edge + 1 >= GLint(nProfile) || (side == 1 && distance == 0))
+					continue;
+
+				const Primitives::ProfilePoint& p0 = profile[edge];
+				const Primitives::ProfilePoint& p1 = profile[edge + 1];
+				float r = p1.y - p0.y;
+				float y = p0.radius - p1.radius;
+				float len = std::sqrt(r * r + y * y);
+				if (len > 0.0f)
+				{
+					nr = r / len;
+					ny = y / len;
+					return;
+				}
+			}
+		}
+		nr = 1.0f;
+		ny = 0.0f;
+	}
+
+	// true when a profile end has a non-zero radius and needs a cap
+	bool HasCap(const Primitives::ProfilePoint& point, bool requested)
+	{
+		return requested && point.radius > 0.0f;
+	}
+}
+
+///////////////////////////////////////////////////
+//	FillRing(GLuint, float*, float*)
+//
+//	segments: number of slices around the axis (at least 3)
+//	cos, sin: receive segments + 1 values each
+//
+//	Return a view of the ring written, equal to MakeRing<segments>()
+///////////////////////////////////////////////////
+Primitives::Ring Primitives::FillRing(GLuint segments, float* cos, float* sin)
+{
+	for (GLuint j = 0; j <= segments; j++)
+	{
+		cos[j] = float(TurnCos(j, segments));
+		sin[j] = float(TurnSin(j, segments));
+	}
+	return { cos, sin, segments };
+}
+
+///////////////////////////////////////////////////
+//	RevolveSize(const ProfilePoint*, GLuint, GLuint, bool, bool)
+//
+//	profile: points from bottom to top, revolved around the Y axis
+//	nProfile: number of profile points (at least 2)
+//	segments: number of slices around the Y axis
+//	capBottom, capTop: close the first / last profile ring with a disk
+//
+//	Return the vertex and index counts written by Revolve()
+///////////////////////////////////////////////////
+Primitives::MeshSize Primitives::RevolveSize(const ProfilePoint* profile, GLuint nProfile, GLuint segments, bool capBottom, bool capTop)
+{
+	MeshSize size = { 0, 0 };
+
+	// every profile edge gets its own pair of rings so edges stay sharp
+	for (GLuint k = 0; k + 1 < nProfile; k++)
+	{
+		size.nVertices += 2 * (segments + 1);
+		// a ring with zero radius collapses one triangle of every quad
+		if (profile[k].radius > 0.0f)
+			size.nIndices += 3 * segments;
+		if (profile[k + 1].radius > 0.0f)
+			size.nIndices += 3 * segments;
+	}
+
+	if (HasCap(profile[0], capBottom))
+	{
+		size.nVertices += segments + 1;
+		size.nIndices += 3 * segments;
+	}
+	if (HasCap(profile[nProfile - 1], capTop))
+	{
+		size.nVertices += segments + 1;
+		size.nIndices += 3 * segments;
+	}
+
+	return size;
+}
+
+///////////////////////////////////////////////////
+//	Revolve(const ProfilePoint*, GLuint, const Ring&, bool, bool, GLfloat*, GLuint*)
+//
+//	ring: slice angles around the Y axis, ring.segments being the segments
+//		passed to RevolveSize()
+//	verts: receives RevolveSize().nVertices interleaved vertices
+//	indices: receives RevolveSize().nIndices triangle indices
+//
+//	Sweep a profile around the Y axis. A profile of {1,0},{1,1} is the unit
+//	cylinder, {1,0},{0,1} is the unit cone.
+///////////////////////////////////////////////////
+void Primitives::Revolve(const ProfilePoint* profile, GLuint nProfile, const Ring& ring,
+	bool capBottom, bool capTop, GLfloat* verts, GLuint* indices)
+{
+	GLuint base = 0;
+	const GLuint segments = ring.segments;
+
+	// sides
+	for (GLuint k = 0; k + 1 < nProfile; k++)
+	{
+		const ProfilePoint& p0 = profile[k];
+		const ProfilePoint& p1 = profile[k + 1];
+
+		// outward normal of the profile edge in the (radius, y) plane
+		float nr;
+		float ny;
+		EdgeNormal(profile, nProfile, k, nr, ny);
+
+		float v0 = float(k) / float(nProfile - 1);
+		float v1 = float(k + 1) / float(nProfile - 1);
+
+		for (GLuint edgeEnd = 0; edgeEnd < 2; edgeEnd++)
+		{
+			const ProfilePoint& p = (edgeEnd == 0) ? p0 : p1;
+			float v = (edgeEnd == 0) ? v0 : v1;
+			for (GLuint j = 0; j <= segments; j++)
+			{
+				float c = ring.cos[j];
+				float s = -ring.sin[j];
+				verts = WriteVertex(verts, p.radius * c, p.y, p.radius * s, nr * c, ny, nr * s, float(j) / segments, v);
+			}
+		}
+
+		// counter-clockwise when seen from outside
+		for (GLuint j = 0; j < segments; j++)
+		{
+			GLuint lower = base + j;
+			GLuint upper = base + segments + 1 + j;
+			if (p0.radius > 0.0f)
+				indices = WriteTriangle(indices, lower, lower + 1, upper + 1);
+			if (p1.radius > 0.0f)
+				indices = WriteTriangle(indices, lower, upper + 1, upper);
+		}
+		base += 2 * (segments + 1);
+	}
+
+	// caps, a center point plus one ring each
+	for (GLuint cap = 0; cap < 2; cap++)
+	{
+		const ProfilePoint& p = (cap == 0) ? profile[0] : profile[nProfile - 1];
+		if (!HasCap(p, (cap == 0) ? capBottom : capTop))
+			continue;
+
+		float ny = (cap == 0) ? -1.0f : 1.0f;
+		verts = WriteVertex(verts, 0.0f, p.y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+		for (GLuint j = 0; j < segments; j++)
+		{
+			float c = ring.cos[j];
+			float s = -ring.sin[j];
+			verts = WriteVertex(verts, p.radius * c, p.y, p.radius * s, 0.0f, ny, 0.0f, 0.5f + 0.5f * c, 0.5f + 0.5f * s);
+		}
+
+		for (GLuint j = 0; j < segments; j++)
+		{
+			GLuint current = base + 1 + j;
+			GLuint next = base + 1 + (j + 1) % segments;
+			if (cap == 0)
+				indices = WriteTriangle(indices, base, next, current);
+			else
+				indices = WriteTriangle(indices, base, current, next);
+		}
+		base += segments + 1;
+	}
+}
+
+///////////////////////////////////////////////////
+//	UVSphereSize(GLuint, GLuint)
+//
+//	sectors: number of slices around the Y axis
+//	stacks: number of rings from pole to pole (at least 2)
+//
+//	Return the vertex and index counts written by UVSphere()
+///////////////////////////////////////////////////
+Primitives::MeshSize Primitives::UVSphereSize(GLuint sectors, GLuint stacks)
+{
+	MeshSize size;
+	size.nVertices = (stacks + 1) * (sectors + 1);
+	size.nIndices = 6 * sectors * (stacks - 1);
+	return size;
+}
+
+///////////////////////////////////////////////////
+//	UVSphere(float, const Ring&, GLuint, GLfloat*, GLuint*)
+//
+//	ring: slice angles around the Y axis, one per sector
+//
+//	Create a latitude / longitude sphere centered on the origin. The seam
+//	column is duplicated so texture coords wrap cleanly; the degenerate
+//	triangles at the poles are not emitted.
+///////////////////////////////////////////////////
+void Primitives::UVSphere(float radius, const Ring& ring, GLuint stacks, GLfloat* verts, GLuint* indices)
+{
+	const GLuint sectors = ring.segments;
+	for (GLuint i = 0; i <= stacks; i++)
+	{
+		// pole to pole is half a turn
+		float ringRadius = float(TurnSin(i, 2 * stacks));
+		float y = float(TurnCos(i, 2 * stacks));
+		for (GLuint j = 0; j <= sectors; j++)
+		{
+			float nx = ringRadius * ring.cos[j];
+			float nz = -ringRadius * ring.sin[j];
+			verts = WriteVertex(verts, radius * nx, radius * y, radius * nz, nx, y, nz,
+				float(j) / sectors, 1.0f - float(i) / stacks);
+		}
+	}
+
+	for (GLuint i = 0; i < stacks; i++)
+	{
+		for (GLuint j = 0; j < sectors; j++)
+		{
+			GLuint upper = i * (sectors + 1) + j;
+			GLuint lower = upper + sectors + 1;
+			if (i != stacks - 1)
+				indices = WriteTriangle(indices, lower, lower + 1, upper + 1);
+			if (i != 0)
+				indices = WriteTriangle(indices, lower, upper + 1, upper);
+		}
+	}
+}
+
+///////////////////////////////////////////////////
+//	IcosphereSize(GLuint)
+//
+//	frequency: number of edge subdivisions of each icosahedron face (at least 1)
+//
+//	Return the vertex and index counts written by Icosphere()
+///////////////////////////////////////////////////
+Primitives::MeshSize Primitives::IcosphereSize(GLuint frequency)
+{
+	MeshSize size;
+	size.nVertices = 10 * (frequency + 1) * (frequency + 2);
+	size.nIndices = 60 * frequency * frequency;
+	return size;
+}
+
+///////////////////////////////////////////////////
+//	Icosphere(float, GLuint, GLfloat*, GLuint*)
+//
+//	Create a geodesic sphere by subdividing each face of an icosahedron into
+//	frequency^2 triangles and projecting the points onto the sphere. Faces are
+//	generated independently so the sizes are known up front; the normals are
+//	analytic, so the duplicated edge vertices do not show.
+///////////////////////////////////////////////////
+void Primitives::Icosphere(float radius, GLuint frequency, GLfloat* verts, GLuint* indices)
+{
+	const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+	const float corners[12][3] = {
+		{-1.0f, t, 0.0f}, {1.0f, t, 0.0f}, {-1.0f, -t, 0.0f}, {1.0f, -t, 0.0f},
+		{0.0f, -1.0f, t}, {0.0f, 1.0f, t}, {0.0f, -1.0f, -t}, {0.0f, 1.0f, -t},
+		{t, 0.0f, -1.0f}, {t, 0.0f, 1.0f}, {-t, 0.0f, -1.0f}, {-t, 0.0f, 1.0f},
+	};
+	const GLuint faces[20][3] = {
+		{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+		{1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+		{3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+		{4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1},
+	};
+
+	const GLuint faceVertices = (frequency + 1) * (frequency + 2) / 2;
+	GLuint base = 0;
+
+	for (GLuint f = 0; f < 20; f++)
+	{
+		const float* a = corners[faces[f][0]];
+		const float* b = corners[faces[f][1]];
+		const float* c = corners[faces[f][2]];
+
+		// row i walks from corner a towards edge bc, column j along the row
+		for (GLuint i = 0; i <= frequency; i++)
+		{
+			for (GLuint j = 0; j <= i; j++)
+			{
+				float s = float(i) / frequency;
+				float r = float(j) / frequency;
+				float p[3];
+				for (int axis = 0; axis < 3; axis++)
+					p[axis] = a[axis] + s * (b[axis] - a[axis]) + r * (c[axis] - b[axis]);
+
+				float len = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+				float nx = p[0] / len;
+				float ny = p[1] / len;
+				float nz = p[2] / len;
+				float u = 0.5f + std::atan2(-nz, nx) / TWO_PI;
+				float v = 0.5f + std::asin(ny) / PI;
+				verts = WriteVertex(verts, radius * nx, radius * ny, radius * nz, nx, ny, nz, u, v);
+			}
+		}
+
+		for (GLuint i = 0; i < frequency; i++)
+		{
+			GLuint row = base + i * (i + 1) / 2;
+			GLuint nextRow = base + (i + 1) * (i + 2) / 2;
+			for (GLuint j = 0; j <= i; j++)
+			{
+				indices = WriteTriangle(indices, row + j, nextRow + j, nextRow + j + 1);
+				if (j < i)
+					indices = WriteTriangle(indices, row + j, nextRow + j + 1, row + j + 1);
+			}
+		}
+		base += faceVertices;
+	}
+}
+
+///////////////////////////////////////////////////
+//	TorusSize(GLuint, GLuint)
+//
+//	mainSegments: number of slices around the torus ring
+//	tubeSegments: number of slices around the tube
+//
+//	Return the vertex and index counts written by Torus()
+///////////////////////////////////////////////////
+Primitives::MeshSize Primitives::TorusSize(GLuint mainSegments, GLuint tubeSegments)
+{
+	MeshSize size;
+	size.nVertices = (mainSegments + 1) * (tubeSegments + 1);
+	size.nIndices = 6 * mainSegments * tubeSegments;
+	return size;
+}
+
+///////////////////////////////////////////////////
+//	Torus(float, float, const Ring&, const Ring&, GLfloat*, GLuint*)
+//
+//	main: slice angles around the torus ring
+//	tube: slice angles around the tube
+//
+//	Create a torus lying in the XY plane around the Z axis as a shared-vertex
+//	grid. The seam row and column are duplicated so texture coords wrap.
+///////////////////////////////////////////////////
+void Primitives::Torus(float mainRadius, float tubeRadius, const Ring& main, const Ring& tube,
+	GLfloat* verts, GLuint* indices)
+{
+	const GLuint mainSegments = main.segments;
+	const GLuint tubeSegments = tube.segments;
+	for (GLuint i = 0; i <= mainSegments; i++)
+	{
+		float cosMain = main.cos[i];
+		float sinMain = main.sin[i];
+		for (GLuint j = 0; j <= tubeSegments; j++)
+		{
+			float cosTube = tube.cos[j];
+			float sinTube = tube.sin[j];
+
+			// the normal points away from the center of the tube
+			float nx = cosTube * cosMain;
+			float ny = cosTube * sinMain;
+			float nz = sinTube;
+			float ring = mainRadius + tubeRadius * cosTube;
+			verts = WriteVertex(verts, ring * cosMain, ring * sinMain, tubeRadius * sinTube, nx, ny, nz,
+				float(i) / mainSegments, float(j) / tubeSegments);
+		}
+	}
+
+	for (GLuint i = 0; i < mainSegments; i++)
+	{
+		for (GLuint j = 0; j < tubeSegments; j++)
+		{
+			GLuint current = i * (tubeSegments + 1) + j;
+			GLuint next = current + tubeSegments + 1;
+			indices = WriteTriangle(indices, current, next, next + 1);
+			indices = WriteTriangle(indices, current, next + 1, current + 1);
+		}
+	}
+}
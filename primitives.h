@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitives.h
+// ========
+// parametric generators for 3D primitives: revolved profiles (cylinder, cone,
+// tapered cylinder), UV sphere, icosphere and torus
+//
+// Every generator writes interleaved vertex data (position, normal, texture
+// coords) and GL_TRIANGLES indices into buffers supplied by the caller. Use
+// the matching *Size() function to find out how large those buffers must be.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "vertexformat.h"
+
+namespace Primitives
+{
+	typedef VertexFormat::FloatLayout Layout;
+	static_assert(Layout::AllOfType(GL_FLOAT), "generators write vertices as plain float arrays");
+
+	// total float values per each type, and where each starts in a vertex
+	const GLuint floatsPerVertex = Layout::Attribute<0>::components;
+	const GLuint floatsPerNormal = Layout::Attribute<1>::components;
+	const GLuint floatsPerUV = Layout::Attribute<2>::components;
+	const GLuint floatsPerElement = Layout::stride / sizeof(GLfloat);
+
+	const GLuint positionOffset = Layout::Offset<0>() / sizeof(GLfloat);
+	const GLuint normalOffset = Layout::Offset<1>() / sizeof(GLfloat);
+	const GLuint uvOffset = Layout::Offset<2>() / sizeof(GLfloat);
+
+	// sin and cos of x in [0, pi/2], by their Taylor series
+	constexpr double QuadrantSin(double x)
+	{
+		double term = x;
+		double sum = x;
+		for (int n = 1; n < 12; n++)
+		{
+			term *= -x * x / double((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+		return sum;
+	}
+	constexpr double QuadrantCos(double x)
+	{
+		double term = 1.0;
+		double sum = 1.0;
+		for (int n = 1; n < 12; n++)
+		{
+			term *= -x * x / double((2 * n - 1) * (2 * n));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// sin and cos of numerator / denominator of a full turn. The angle is
+	// reduced to the first quadrant in integers, so quarter turns come out
+	// exact. Usable in constant expressions; at run time the results are
+	// bit for bit the same.
+	constexpr double TurnSin(GLuint numerator, GLuint denominator)
+	{
+		unsigned long long quarters = 4ull * (numerator % denominator);
+		double x = 1.57079632679489661923 * double(quarters % denominator) / double(denominator);
+		switch (quarters / denominator)
+		{
+		case 0: return QuadrantSin(x);
+		case 1: return QuadrantCos(x);
+		case 2: return -QuadrantSin(x);
+		default: return -QuadrantCos(x);
+		}
+	}
+	constexpr double TurnCos(GLuint numerator, GLuint denominator)
+	{
+		// a quarter turn ahead of the sine
+		return TurnSin(4 * (numerator % denominator) + denominator, 4 * denominator);
+	}
+
+	// cos and sin of 2 pi j / segments for j = 0..segments. The last entry
+	// repeats the first exactly so seams close.
+	struct Ring
+	{
+		const float* cos;
+		const float* sin;
+		GLuint segments;
+	};
+
+	// A ring whose segment count is known at compile time, built by the
+	// compiler when declared constexpr
+	template <GLuint Segments>
+	struct RingTable
+	{
+		static_assert(Segments >= 3, "a ring needs at least 3 segments");
+
+		float cos[Segments + 1];
+		float sin[Segments + 1];
+
+		constexpr Ring View() const { return { cos, sin, Segments }; }
+	};
+
+	template <GLuint Segments>
+	constexpr RingTable<Segments> MakeRing()
+	{
+		RingTable<Segments> table = {};
+		for (GLuint j = 0; j <= Segments; j++)
+		{
+			table.cos[j] = float(TurnCos(j, Segments));
+			table.sin[j] = float(TurnSin(j, Segments));
+		}
+		return table;
+	}
+
+	// The same ring for a segment count chosen at run time; cos and sin must
+	// hold segments + 1 floats each
+	Ring FillRing(GLuint segments, float* cos, float* sin);
+
+	// Number of vertices and indices a generator will write
+	struct MeshSize
+	{
+		GLuint nVertices;
+		GLuint nIndices;
+	};
+
+	// A point on a revolve profile: distance from the Y axis and height
+	struct ProfilePoint
+	{
+		float radius;
+		float y;
+	};
+
+	MeshSize RevolveSize(const ProfilePoint* profile, GLuint nProfile, GLuint segments, bool capBottom, bool capTop);
+	MeshSize UVSphereSize(GLuint sectors, GLuint stacks);
+	MeshSize IcosphereSize(GLuint frequency);
+	MeshSize TorusSize(GLuint mainSegments, GLuint tubeSegments);
+
+	// The generators sweeping around an axis take the ring of slice angles
+	// rather than a segment count, so no trigonometry runs per vertex
+	void Revolve(const ProfilePoint* profile, GLuint nProfile, const Ring& ring,
+		bool capBottom, bool capTop, GLfloat* verts, GLuint* indices);
+	void UVSphere(float radius, const Ring& ring, GLuint stacks, GLfloat* verts, GLuint* indices);
+	void Icosphere(float radius, GLuint frequency, GLfloat* verts, GLuint* indices);
+	void Torus(float mainRadius, float tubeRadius, const Ring& main, const Ring& tube,
+		GLfloat* verts, GLuint* indices);
+}
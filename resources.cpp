@@ -0,0 +1,361 @@
+///////////////////////////////////////////////////////////////////////////////
+// resources.cpp
+// ========
+// textures and models shared by handle, loaded once per path or contents
+///////////////////////////////////////////////////////////////////////////////
+
+#include "resources.h"
+#include "mappedfile.h"
+#include "meshcache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	// Everything besides the file that shapes a texture made from it
+	std::uint64_t OptionsHash(const Textures::DecodeOptions& options)
+	{
+		const std::uint32_t fields[] = { std::uint32_t(options.channels), std::uint32_t(options.flipVertically),
+			std::uint32_t(options.linearize), std::uint32_t(options.premultiplyAlpha) };
+		return MeshCache::Hash(fields, sizeof(fields));
+	}
+
+	// Hash of the file's bytes; false when it cannot be read
+	bool FileKey(const char* path, std::uint64_t seed, std::uint64_t& key)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+			return false;
+
+		key = MeshCache::Hash(file.Data(), file.Size(), seed);
+		return true;
+	}
+
+	// A .gltf names its buffers by relative path, so two equal .gltf files
+	// in different directories can still hold different geometry
+	bool SelfContained(const char* path)
+	{
+		std::string extension = std::filesystem::path(path).extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return char(std::tolower(c)); });
+		return extension != ".gltf";
+	}
+
+	// Entry a handle refers to, nullptr if it is null, stale or released
+	template <typename Slots, typename Handle>
+	auto Find(Slots& slots, Handle handle) -> decltype(&slots[0])
+	{
+		if (!handle || handle.slot > slots.size())
+			return nullptr;
+
+		auto* entry = &slots[handle.slot - 1];
+		return entry->generation == handle.generation && entry->references > 0 ? entry : nullptr;
+	}
+}
+
+ResourceManager::ResourceManager(TextureStreamer& streamer, Meshes& meshes)
+	: streamer(streamer), meshes(meshes), nShared(0)
+{
+}
+
+ResourceManager::~ResourceManager()
+{
+	Destroy();
+}
+
+///////////////////////////////////////////////////
+//	AcquireTexture(const char*, const DecodeOptions&)
+//
+//	Only the path is matched here, so acquiring never waits on the file;
+//	the streamer hashes it on the pool while decoding, and Update() merges
+//	duplicates once that is done
+///////////////////////////////////////////////////
+ResourceManager::TextureHandle ResourceManager::AcquireTexture(const char* path, const Textures::DecodeOptions& options)
+{
+	std::string key = UPathKey(path, OptionsHash(options));
+	auto found = textureLookup.find(key);
+
+	TextureHandle handle;
+	if (found != textureLookup.end())
+	{
+		TextureEntry& entry = textures[found->second];
+		entry.references++;
+		nShared++;
+		handle.slot = found->second + 1;
+		handle.generation = entry.generation;
+		return handle;
+	}
+
+	std::uint32_t slot;
+	if (!freeTextures.empty())
+	{
+		slot = freeTextures.back();
+		freeTextures.pop_back();
+	}
+	else
+	{
+		slot = std::uint32_t(textures.size());
+		textures.push_back(TextureEntry());
+	}
+
+	TextureEntry& entry = textures[slot];
+	entry.path = path;
+	entry.keys.assign(1, key);
+	entry.contentKey = 0;
+	entry.hasContentKey = false;
+	entry.contentPending = true;
+	entry.references = 1;
+	entry.id = streamer.Load(path, options);
+
+	textureLookup.emplace(key, slot);
+
+	handle.slot = slot + 1;
+	handle.generation = entry.generation;
+	return handle;
+}
+
+///////////////////////////////////////////////////
+//	AcquireModel(const char*)
+//
+//	Models released down to no references are still found, their meshes
+//	still in the arena
+///////////////////////////////////////////////////
+ResourceManager::ModelHandle ResourceManager::AcquireModel(const char* path)
+{
+	std::string key = UPathKey(path, 0);
+
+	std::uint64_t contentKey = 0;
+	bool hasContentKey = false;
+	auto found = modelLookup.find(key);
+	if (found == modelLookup.end())
+	{
+		hasContentKey = SelfContained(path) && FileKey(path, 0, contentKey);
+		auto same = hasContentKey ? modelContents.find(contentKey) : modelContents.end();
+		if (same != modelContents.end())
+		{
+			std::cout << "INFO: Model " << path << " has the same contents as " << models[same->second].path
+				<< ", shared" << std::endl;
+			models[same->second].keys.push_back(key);
+			found = modelLookup.emplace(key, same->second).first;
+		}
+	}
+
+	ModelHandle handle;
+	if (found != modelLookup.end())
+	{
+		ModelEntry& entry = models[found->second];
+		entry.references++;
+		nShared++;
+		handle.slot = found->second + 1;
+		handle.generation = entry.generation;
+		return handle;
+	}
+
+	// the arena is built once, with every model queued by then
+	if (meshes.MeshCount() > 0)
+	{
+		std::cout << "Failed to load model " << path << ", meshes are already created" << std::endl;
+		return handle;
+	}
+
+	std::uint32_t slot = std::uint32_t(models.size());
+	models.push_back(ModelEntry());
+	ModelEntry& entry = models.back();
+	entry.path = path;
+	entry.keys.assign(1, key);
+	entry.contentKey = contentKey;
+	entry.hasContentKey = hasContentKey;
+	entry.references = 1;
+	entry.model = meshes.AddModel(path);
+
+	modelLookup.emplace(key, slot);
+	if (hasContentKey)
+		modelContents.emplace(contentKey, slot);
+
+	handle.slot = slot + 1;
+	handle.generation = entry.generation;
+	return handle;
+}
+
+ResourceManager::TextureHandle ResourceManager::Retain(TextureHandle handle)
+{
+	TextureEntry* entry = Find(textures, handle);
+	if (!entry)
+		return TextureHandle();
+
+	entry->references++;
+	return handle;
+}
+
+ResourceManager::ModelHandle ResourceManager::Retain(ModelHandle handle)
+{
+	ModelEntry* entry = Find(models, handle);
+	if (!entry)
+		return ModelHandle();
+
+	entry->references++;
+	return handle;
+}
+
+void ResourceManager::Release(TextureHandle& handle)
+{
+	TextureEntry* entry = Find(textures, handle);
+	if (entry && --entry->references == 0)
+		UFreeTexture(handle.slot - 1);
+	handle = TextureHandle();
+}
+
+void ResourceManager::Release(ModelHandle& handle)
+{
+	ModelEntry* entry = Find(models, handle);
+	if (entry)
+		entry->references--;
+	handle = ModelHandle();
+}
+
+GLuint ResourceManager::Texture(TextureHandle handle) const
+{
+	const TextureEntry* entry = Find(textures, handle);
+	return entry ? entry->id : 0;
+}
+
+const Meshes::Model* ResourceManager::Model(ModelHandle handle) const
+{
+	const ModelEntry* entry = Find(models, handle);
+	return entry ? &meshes.models[entry->model] : nullptr;
+}
+
+///////////////////////////////////////////////////
+//	Update()
+//
+//	The first live texture with a given content key keeps it; later ones
+//	with the same key become duplicates of it
+///////////////////////////////////////////////////
+void ResourceManager::Update()
+{
+	for (std::uint32_t slot = 0; slot < textures.size(); slot++)
+	{
+		TextureEntry& entry = textures[slot];
+		std::uint64_t key = 0;
+		if (!entry.contentPending || entry.references == 0 || !streamer.ContentKey(entry.id, key))
+			continue;
+
+		entry.contentPending = false;
+		if (key == 0)
+			continue;
+
+		auto same = textureContents.find(key);
+		if (same != textureContents.end())
+		{
+			UMergeTexture(slot, same->second);
+			continue;
+		}
+		entry.contentKey = key;
+		entry.hasContentKey = true;
+		textureContents.emplace(key, slot);
+	}
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Handles still held go stale; models are forgotten, their meshes go
+//	with Meshes::DestroyMeshes()
+///////////////////////////////////////////////////
+void ResourceManager::Destroy()
+{
+	// duplicates first, so the references they hold are not reported
+	for (int duplicates = 1; duplicates >= 0; duplicates--)
+	{
+		for (std::uint32_t slot = 0; slot < textures.size(); slot++)
+		{
+			TextureEntry& entry = textures[slot];
+			if (entry.references == 0 || (entry.original != 0) != bool(duplicates))
+				continue;
+
+			std::cout << "WARNING: Texture " << entry.path << " still has " << entry.references << " references" << std::endl;
+			entry.references = 0;
+			UFreeTexture(slot);
+		}
+	}
+	for (const ModelEntry& entry : models)
+	{
+		if (entry.references > 0)
+			std::cout << "WARNING: Model " << entry.path << " still has " << entry.references << " references" << std::endl;
+	}
+
+	textures.clear();
+	freeTextures.clear();
+	textureLookup.clear();
+	textureContents.clear();
+	models.clear();
+	modelLookup.clear();
+	modelContents.clear();
+}
+
+///////////////////////////////////////////////////
+//	UFreeTexture(std::uint32_t)
+//
+//	Delete the texture, or drop the reference a duplicate holds on the
+//	texture it shares, and retire the slot's handles
+///////////////////////////////////////////////////
+void ResourceManager::UFreeTexture(std::uint32_t slot)
+{
+	TextureEntry& entry = textures[slot];
+	std::uint32_t original = entry.original;
+	if (!original)
+		streamer.Unload(entry.id);
+	for (const std::string& key : entry.keys)
+		textureLookup.erase(key);
+	if (entry.hasContentKey)
+		textureContents.erase(entry.contentKey);
+
+	entry.path.clear();
+	entry.keys.clear();
+	entry.hasContentKey = false;
+	entry.contentPending = false;
+	entry.original = 0;
+	entry.id = 0;
+	if (++entry.generation == 0)
+		entry.generation = 1;
+	freeTextures.push_back(slot);
+
+	if (original && textures[original - 1].references > 0 && --textures[original - 1].references == 0)
+		UFreeTexture(original - 1);
+}
+
+///////////////////////////////////////////////////
+//	UMergeTexture(std::uint32_t, std::uint32_t)
+//
+//	Hand out the texture of slot original for slot's handles from now on
+//	and delete slot's own, decoded for nothing
+///////////////////////////////////////////////////
+void ResourceManager::UMergeTexture(std::uint32_t slot, std::uint32_t original)
+{
+	TextureEntry& entry = textures[slot];
+	TextureEntry& shared = textures[original];
+	std::cout << "INFO: Texture " << entry.path << " has the same contents as " << shared.path << ", shared" << std::endl;
+
+	streamer.Unload(entry.id);
+	entry.id = shared.id;
+	entry.original = original + 1;
+	shared.references++;
+	nShared++;
+}
+
+///////////////////////////////////////////////////
+//	UPathKey(const char*, std::uint64_t)
+//
+//	"<path, lexically normalized>|<settingsHash as 16 hex digits>", so
+//	"./a/../b.png" and "b.png" match without asking the file system
+///////////////////////////////////////////////////
+std::string ResourceManager::UPathKey(const char* path, std::uint64_t settingsHash)
+{
+	char settings[24];
+	std::snprintf(settings, sizeof(settings), "|%016llx", static_cast<unsigned long long>(settingsHash));
+	return std::filesystem::path(path).lexically_normal().generic_string() + settings;
+}
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// resources.h
+// ========
+// textures and models shared by everything that draws with them: each file
+// is loaded once and handed out by handle, with a reference count per load
+//
+// Loads are matched by path at once. Textures are also matched by contents,
+// once the streamer has read their file on the pool: a texture found to
+// duplicate a live one hands out that one instead, and its own is deleted.
+// A texture is deleted when its last reference is released. Models live in the mesh arena Meshes
+// builds once, so a released model keeps its ranges, and acquiring it
+// again hands them back without importing. Use from the GL thread only.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "meshes.h"
+#include "textures.h"
+#include "texturestreamer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ResourceManager
+{
+public:
+	// Reference to one loaded resource. Default constructed handles are
+	// null; a handle outliving its resource finds nothing.
+	template <typename Resource>
+	struct Handle
+	{
+		std::uint32_t slot = 0;
+		std::uint32_t generation = 0;	// 0 for null
+
+		explicit operator bool() const { return generation != 0; }
+	};
+	typedef Handle<struct TextureResource> TextureHandle;
+	typedef Handle<struct ModelResource> ModelHandle;
+
+	// Textures load through streamer, models are queued on meshes; both
+	// must outlive the manager
+	ResourceManager(TextureStreamer& streamer, Meshes& meshes);
+	~ResourceManager();
+
+	// Texture of path decoded with options, loading it if no live texture
+	// was acquired by the same path. Never reads the file.
+	TextureHandle AcquireTexture(const char* path, const Textures::DecodeOptions& options = Textures::DecodeOptions());
+
+	// Model of path, queued for Meshes::CreateMeshes() if no model matches.
+	// Null for a new model once the meshes are created.
+	ModelHandle AcquireModel(const char* path);
+
+	// One more reference to a live resource; returns it
+	TextureHandle Retain(TextureHandle handle);
+	ModelHandle Retain(ModelHandle handle);
+
+	// Drop the reference handle holds and null it
+	void Release(TextureHandle& handle);
+	void Release(ModelHandle& handle);
+
+	// Texture name, 0 for a null or stale handle
+	GLuint Texture(TextureHandle handle) const;
+
+	// Registry entry of the model, nullptr for a null or stale handle. Its
+	// meshes are filled in by Meshes::CreateMeshes().
+	const Meshes::Model* Model(ModelHandle handle) const;
+
+	// Share textures whose files turned out to hold the same contents.
+	// Call once a frame, after the streamer's Update().
+	void Update();
+
+	// Delete every texture, reporting those still referenced. Call before
+	// the streamer's Destroy().
+	void Destroy();
+
+	// Textures alive, models imported or queued, and loads saved by matching
+	std::size_t TextureCount() const { return textures.size() - freeTextures.size(); }
+	std::size_t ModelCount() const { return models.size(); }
+	std::size_t SharedLoadCount() const { return nShared; }
+
+private:
+	ResourceManager(const ResourceManager&) = delete;
+	ResourceManager& operator=(const ResourceManager&) = delete;
+
+	// Everything a handle can reach
+	struct Entry
+	{
+		std::string path;				// As first acquired
+		std::vector<std::string> keys;	// Path keys it was acquired by, see UPathKey()
+		std::uint64_t contentKey = 0;
+		bool hasContentKey = false;		// False when the file could not be read
+		std::uint32_t generation = 1;	// Bumped when the slot is freed
+		std::uint32_t references = 0;
+	};
+
+	struct TextureEntry : Entry
+	{
+		GLuint id = 0;
+		bool contentPending = false;	// Contents not known to the streamer yet
+		std::uint32_t original = 0;		// Slot + 1 of the texture this one duplicates, 0 if none; holds a reference to it
+	};
+
+	struct ModelEntry : Entry
+	{
+		std::size_t model = 0;			// Index in Meshes::models
+	};
+
+	void UFreeTexture(std::uint32_t slot);
+	void UMergeTexture(std::uint32_t slot, std::uint32_t original);
+	static std::string UPathKey(const char* path, std::uint64_t settingsHash);
+
+	TextureStreamer& streamer;
+	Meshes& meshes;
+
+	// Slots are indexed by handle slot - 1; freed texture slots are reused
+	std::vector<TextureEntry> textures;
+	std::vector<std::uint32_t> freeTextures;
+	std::unordered_map<std::string, std::uint32_t> textureLookup;
+	std::unordered_map<std::uint64_t, std::uint32_t> textureContents;	// Only textures that are not duplicates
+
+	// Models are never freed, so their slots are never reused
+	std::vector<ModelEntry> models;
+	std::unordered_map<std::string, std::uint32_t> modelLookup;
+	std::unordered_map<std::uint64_t, std::uint32_t> modelContents;
+
+	std::size_t nShared;
+};
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// samplers.cpp
+// ========
+// shared sampler objects holding the filtering and wrapping of every texture
+///////////////////////////////////////////////////////////////////////////////
+
+#include "samplers.h"
+#include "gpuresources.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	using Samplers::Preset;
+
+	const GLsizei nPresets = GLsizei(Preset::Count);
+	const char* const presetNames[nPresets] = { "bilinear sampler", "trilinear sampler", "anisotropic sampler" };
+	const GLenum minFilters[nPresets] = { GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR };
+
+	GLuint gSamplers[nPresets] = {};
+
+	// Preset bound to the texture units, Count before the first Bind()
+	Preset gBound = Preset::Count;
+}
+
+///////////////////////////////////////////////////
+//	Create()
+//
+//	Anisotropy is clamped to the context's limit
+///////////////////////////////////////////////////
+bool Samplers::Create()
+{
+	GLfloat anisotropy = 1.0f;
+	if (GLEW_EXT_texture_filter_anisotropic)
+	{
+		GLfloat limit = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &limit);
+		anisotropy = std::min(maxAnisotropy, limit);
+	}
+	else
+		std::cout << "WARNING: Anisotropic filtering not supported, sampling trilinearly" << std::endl;
+
+	for (GLsizei i = 0; i < nPresets; i++)
+	{
+		GpuResources::GenSamplers(1, &gSamplers[i], presetNames[i]);
+		if (!gSamplers[i])
+		{
+			std::cout << "Failed to create " << presetNames[i] << std::endl;
+			Destroy();
+			return false;
+		}
+		glSamplerParameteri(gSamplers[i], GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glSamplerParameteri(gSamplers[i], GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glSamplerParameteri(gSamplers[i], GL_TEXTURE_MIN_FILTER, GLint(minFilters[i]));
+		glSamplerParameteri(gSamplers[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (Preset(i) == Preset::Anisotropic && anisotropy > 1.0f)
+			glSamplerParameterf(gSamplers[i], GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+	}
+
+	gBound = Preset::Count;
+	return true;
+}
+
+void Samplers::Destroy()
+{
+	for (GLsizei i = 0; i < nPresets; i++)
+	{
+		if (gSamplers[i])
+			GpuResources::DeleteSamplers(1, &gSamplers[i]);
+		gSamplers[i] = 0;
+	}
+	gBound = Preset::Count;
+}
+
+GLuint Samplers::Get(Preset preset)
+{
+	return gSamplers[std::size_t(preset)];
+}
+
+///////////////////////////////////////////////////
+//	Bind(Preset)
+//
+//	One glBindSamplers() call covers every unit
+///////////////////////////////////////////////////
+void Samplers::Bind(Preset preset)
+{
+	if (preset == gBound)
+		return;
+
+	GLuint names[nUnits];
+	std::fill(names, names + nUnits, Get(preset));
+	glBindSamplers(0, nUnits, names);
+	gBound = preset;
+}
@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+// samplers.h
+// ========
+// shared sampler objects holding the filtering and wrapping of every texture
+//
+// Textures carry no sampling state of their own; a material names a preset
+// and Materials::Apply() binds that preset's sampler to the texture units.
+// Sampler state overrides whatever parameters a texture has.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+namespace Samplers
+{
+	// Every preset repeats in both directions and filters linearly when
+	// magnifying
+	enum class Preset
+	{
+		Bilinear,		// Level 0 only, for textures without mips
+		Trilinear,		// Blends the two nearest mips
+		Anisotropic,	// Trilinear, with extra taps along the direction of stretch
+		Count
+	};
+
+	const GLuint nUnits = 8;			// Texture units a preset is bound to
+	const float maxAnisotropy = 8.0f;	// Lowered to what the context supports
+
+	// Create the sampler of every preset; call after glewInit(). Without
+	// anisotropic filtering support, Anisotropic samples as Trilinear.
+	bool Create();
+	void Destroy();
+
+	GLuint Get(Preset preset);
+
+	// Bind preset to units [0, nUnits); nothing is called when it already is
+	void Bind(Preset preset);
+}
@@ -0,0 +1,309 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.cpp
+// ========
+// small images packed together into shared atlas pages, so that drawing
+// with any of them binds the same texture
+///////////////////////////////////////////////////////////////////////////////
+
+#include "textureatlas.h"
+#include "gpuresources.h"
+#include "mipmaps.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+namespace
+{
+	const int channels = 4;
+
+	int RoundUp(int value, int alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	///////////////////////////////////////////////////
+	//	Skyline
+	//
+	//	The top edge of everything placed on a page, as runs of equal
+	//	height from left to right. Rectangles go where their top ends
+	//	lowest, leftmost on ties.
+	///////////////////////////////////////////////////
+	class Skyline
+	{
+	public:
+		explicit Skyline(int size) : size(size), usedWidth(0), usedHeight(0)
+		{
+			nodes.push_back({ 0, 0, size });
+		}
+
+		bool Insert(int width, int height, int& x, int& y)
+		{
+			std::size_t best = nodes.size();
+			int bestTop = size + 1;
+			for (std::size_t i = 0; i < nodes.size(); i++)
+			{
+				int top = Fit(i, width, height);
+				if (top >= 0 && top + height < bestTop)
+				{
+					best = i;
+					bestTop = top + height;
+				}
+			}
+			if (best == nodes.size())
+				return false;
+
+			x = nodes[best].x;
+			y = bestTop - height;
+			nodes.insert(nodes.begin() + best, Node{ x, bestTop, width });
+
+			// cut the runs the new one now covers
+			int right = x + width;
+			std::size_t next = best + 1;
+			while (next < nodes.size() && nodes[next].x < right)
+			{
+				int covered = std::min(right - nodes[next].x, nodes[next].width);
+				nodes[next].x += covered;
+				nodes[next].width -= covered;
+				if (nodes[next].width > 0)
+					break;
+				nodes.erase(nodes.begin() + next);
+			}
+
+			for (std::size_t i = 0; i + 1 < nodes.size();)
+			{
+				if (nodes[i].y == nodes[i + 1].y)
+				{
+					nodes[i].width += nodes[i + 1].width;
+					nodes.erase(nodes.begin() + i + 1);
+				}
+				else
+					i++;
+			}
+
+			usedWidth = std::max(usedWidth, right);
+			usedHeight = std::max(usedHeight, bestTop);
+			return true;
+		}
+
+		int UsedWidth() const { return usedWidth; }
+		int UsedHeight() const { return usedHeight; }
+
+	private:
+		struct Node
+		{
+			int x;
+			int y;
+			int width;
+		};
+
+		// Bottom of a rectangle whose left edge is at node i, -1 if it does
+		// not fit there
+		int Fit(std::size_t i, int width, int height) const
+		{
+			if (nodes[i].x + width > size)
+				return -1;
+			int y = 0;
+			for (int remaining = width; remaining > 0; i++)
+			{
+				y = std::max(y, nodes[i].y);
+				if (y + height > size)
+					return -1;
+				remaining -= nodes[i].width;
+			}
+			return y;
+		}
+
+		int size;
+		int usedWidth;
+		int usedHeight;
+		std::vector<Node> nodes;
+	};
+
+	// Where one image goes on its page
+	struct Placement
+	{
+		int page = -1;
+		int x = 0;			// Of the rectangle, gutter and rounding included
+		int y = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	// Copy image gutter texels in from the lower left of its rectangle,
+	// repeating its edge texels out to every side of the rectangle
+	void Blit(const Textures::Image& image, const Placement& placement, int gutter, unsigned char* page, int pageWidth)
+	{
+		std::size_t rowBytes = std::size_t(image.width) * channels;
+		int right = placement.width - gutter - image.width;
+		for (int j = 0; j < placement.height; j++)
+		{
+			int row = std::clamp(j - gutter, 0, image.height - 1);
+			const unsigned char* src = image.pixels + std::size_t(row) * rowBytes;
+			unsigned char* dst = page + (std::size_t(placement.y + j) * pageWidth + placement.x) * channels;
+			for (int i = 0; i < gutter; i++, dst += channels)
+				std::memcpy(dst, src, channels);
+			std::memcpy(dst, src, rowBytes);
+			dst += rowBytes;
+			for (int i = 0; i < right; i++, dst += channels)
+				std::memcpy(dst, src + rowBytes - channels, channels);
+		}
+	}
+}
+
+TextureAtlas::TextureAtlas()
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	Destroy();
+}
+
+///////////////////////////////////////////////////
+//	Build(const char* const*, std::size_t, const Settings&, ThreadPool&)
+//
+//	Every image's rectangle, gutter included, is rounded up to the size of
+//	the smallest mip's texels, so the box filtered mips never average two
+//	images into one texel. Mips are built on the CPU in linear light, as
+//	for streamed textures.
+///////////////////////////////////////////////////
+bool TextureAtlas::Build(const char* const* paths, std::size_t nPaths, const Settings& settings, ThreadPool& pool)
+{
+	Destroy();
+
+	int gutter = std::max(settings.gutter, 0);
+	if (gutter & (gutter - 1))
+	{
+		std::cout << "WARNING: Atlas gutter " << gutter << " is not a power of two, atlas not mipmapped" << std::endl;
+		gutter = 0;
+	}
+	GLsizei nLevels = 1;
+	while ((1 << nLevels) <= gutter)
+		nLevels++;
+	int alignment = 1 << (nLevels - 1);
+
+	Textures::DecodeOptions options = settings.options;
+	options.channels = channels;
+
+	// a wider filter would reach across the gutter into the neighbours
+	Mipmaps::Options mipOptions;
+	mipOptions.filter = Mipmaps::Filter::Box;
+	mipOptions.srgb = !options.linearize;
+	mipOptions.wrap = false;
+	std::vector<Textures::Image> images(nPaths);
+	pool.ParallelFor(nPaths, [&](std::size_t i) {
+		Textures::Decode(paths[i], images[i], options, pool);
+	});
+
+	// tallest first keeps the skyline flat
+	std::vector<std::size_t> order(nPaths);
+	std::iota(order.begin(), order.end(), std::size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+		return images[a].height > images[b].height;
+	});
+
+	bool built = true;
+	std::vector<Skyline> skylines;
+	std::vector<Placement> placements(nPaths);
+	for (std::size_t i : order)
+	{
+		const Textures::Image& image = images[i];
+		if (!image.pixels)
+		{
+			std::cout << "Failed to load texture " << paths[i] << std::endl;
+			built = false;
+			continue;
+		}
+
+		int width = RoundUp(image.width + 2 * gutter, alignment);
+		int height = RoundUp(image.height + 2 * gutter, alignment);
+		if (width > settings.pageSize || height > settings.pageSize)
+		{
+			std::cout << "Failed to pack " << paths[i] << ", larger than an atlas page" << std::endl;
+			built = false;
+			continue;
+		}
+
+		Placement& placement = placements[i];
+		placement.width = width;
+		placement.height = height;
+		for (std::size_t p = 0; p < skylines.size() && placement.page < 0; p++)
+		{
+			if (skylines[p].Insert(width, height, placement.x, placement.y))
+				placement.page = int(p);
+		}
+		if (placement.page < 0)
+		{
+			skylines.emplace_back(settings.pageSize);
+			skylines.back().Insert(width, height, placement.x, placement.y);
+			placement.page = int(skylines.size() - 1);
+		}
+	}
+
+	// pages shrink to what was used of them
+	std::vector<glm::ivec2> pageSizes;
+	for (std::size_t p = 0; p < skylines.size(); p++)
+	{
+		glm::ivec2 size(RoundUp(skylines[p].UsedWidth(), alignment), RoundUp(skylines[p].UsedHeight(), alignment));
+		std::vector<unsigned char> texels(std::size_t(size.x) * size.y * channels, 0);
+		for (std::size_t i = 0; i < nPaths; i++)
+		{
+			if (placements[i].page == int(p))
+				Blit(images[i], placements[i], gutter, texels.data(), size.x);
+		}
+
+		GLuint id = 0;
+		GpuResources::GenTextures(1, &id, "texture atlas");
+		glBindTexture(GL_TEXTURE_2D, id);
+		GLsizei pageLevels = std::min(nLevels, GLsizei(Textures::LevelCount(size.x, size.y)));
+		glTexStorage2D(GL_TEXTURE_2D, pageLevels, GL_RGBA8, size.x, size.y);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+		std::vector<unsigned char> halved;
+		glm::ivec2 levelSize = size;
+		for (GLsizei level = 1; level < pageLevels; level++)
+		{
+			glm::ivec2 halvedSize(std::max(levelSize.x / 2, 1), std::max(levelSize.y / 2, 1));
+			halved.resize(std::size_t(halvedSize.x) * halvedSize.y * channels);
+			Mipmaps::Downsample(texels.data(), levelSize.x, levelSize.y, channels, halved.data(), mipOptions, pool);
+			glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, halvedSize.x, halvedSize.y, GL_RGBA, GL_UNSIGNED_BYTE, halved.data());
+			texels.swap(halved);
+			levelSize = halvedSize;
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		std::size_t bytes = 0;
+		for (GLsizei level = 0; level < pageLevels; level++)
+			bytes += std::size_t(std::max(size.x >> level, 1)) * std::max(size.y >> level, 1) * channels;
+		GpuResources::SetSize(GpuResources::Kind::Texture, id, bytes);
+
+		pages.push_back(id);
+		pageSizes.push_back(size);
+	}
+
+	std::size_t nPacked = 0;
+	regions.assign(nPaths, Region{ 0, glm::vec4(1.0f, 1.0f, 0.0f, 0.0f) });
+	for (std::size_t i = 0; i < nPaths; i++)
+	{
+		const Placement& placement = placements[i];
+		if (placement.page < 0)
+			continue;
+		nPacked++;
+		glm::vec2 size(pageSizes[placement.page]);
+		regions[i].texture = pages[placement.page];
+		regions[i].uvScaleOffset = glm::vec4(images[i].width / size.x, images[i].height / size.y,
+			(placement.x + gutter) / size.x, (placement.y + gutter) / size.y);
+	}
+
+	std::cout << "INFO: Packed " << nPacked << " textures into " << pages.size() << " atlas pages" << std::endl;
+	return built;
+}
+
+void TextureAtlas::Destroy()
+{
+	if (!pages.empty())
+		GpuResources::DeleteTextures(GLsizei(pages.size()), pages.data());
+	pages.clear();
+	regions.clear();
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.h
+// ========
+// small images packed together into shared atlas pages, so that drawing
+// with any of them binds the same texture
+//
+// Images are placed bottom-left first along a skyline of each page, tallest
+// first; a new page opens when one does not fit. Each image is ringed by a
+// gutter repeating its edge texels, and pages only get as many mip levels
+// as the gutter covers, so neither filtering nor mips blend neighbours
+// together. Regions map an image's own [0, 1] texture coordinates into its
+// page; images in an atlas cannot repeat.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include "textures.h"
+#include "threadpool.h"
+
+#include <cstddef>
+#include <vector>
+
+class TextureAtlas
+{
+public:
+	struct Settings
+	{
+		int pageSize = 1024;	// Most texels along either side of a page
+		int gutter = 8;			// Edge texels repeated around each image; a power of two, or 0
+		Textures::DecodeOptions options;	// Channels are always 4
+	};
+
+	// Where one image ended up
+	struct Region
+	{
+		GLuint texture;				// Page holding the image, 0 if it failed to load
+		glm::vec4 uvScaleOffset;	// Page coordinates are uv * xy + zw
+	};
+
+	TextureAtlas();
+	~TextureAtlas();
+
+	// Decode nPaths files on pool, pack them and upload the pages. regions
+	// receives them in path order. Return false if any file failed.
+	bool Build(const char* const* paths, std::size_t nPaths) { return Build(paths, nPaths, Settings()); }
+	bool Build(const char* const* paths, std::size_t nPaths, const Settings& settings,
+		ThreadPool& pool = ThreadPool::Shared());
+
+	// Delete every page
+	void Destroy();
+
+	std::vector<Region> regions;
+	std::vector<GLuint> pages;
+
+private:
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+};
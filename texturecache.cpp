@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ========
+// on-disk cache of GPU-ready textures, keyed by the source file's contents
+///////////////////////////////////////////////////////////////////////////////
+
+#include "texturecache.h"
+#include "mappedfile.h"
+#include "meshcache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+bool TextureCache::Prepare(const char* directory)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	return std::filesystem::is_directory(directory, error);
+}
+
+///////////////////////////////////////////////////
+//	Key(const char*, std::uint64_t, std::uint64_t&)
+//
+//	The file is mapped rather than read, so hashing it also pages it in
+//	for the decode that follows a miss
+///////////////////////////////////////////////////
+bool TextureCache::Key(const char* sourcePath, std::uint64_t settingsHash, std::uint64_t& key)
+{
+	MappedFile source;
+	if (!source.Open(sourcePath))
+		return false;
+
+	key = MeshCache::Hash(source.Data(), source.Size(), settingsHash);
+	return true;
+}
+
+std::string TextureCache::EntryPath(const char* directory, std::uint64_t key)
+{
+	char name[24];
+	std::snprintf(name, sizeof(name), "%016llx.dds", (unsigned long long)key);
+	return std::string(directory) + "/" + name;
+}
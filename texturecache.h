@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ========
+// on-disk cache of GPU-ready textures: the final texels of every mip level,
+// block compressed or not, keyed by the source file's contents
+//
+// Entries are DDS files named after their key and read back through
+// TextureFile, memory-mapped, so a warm start uploads straight from the
+// page cache with no decoding, flipping or mip generation. Changing a
+// source file changes its key; stale entries are left behind, not reused.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace TextureCache
+{
+	// Create directory if it does not exist yet
+	bool Prepare(const char* directory);
+
+	// Hash of the file's bytes, seeded with settingsHash (everything else that
+	// shapes the texels made from it). False when the file cannot be read.
+	bool Key(const char* sourcePath, std::uint64_t settingsHash, std::uint64_t& key);
+
+	// "<directory>/<key as 16 hex digits>.dds"
+	std::string EntryPath(const char* directory, std::uint64_t key);
+}
@@ -0,0 +1,368 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturefile.cpp
+// ========
+// block compressed textures stored in DDS or KTX2 files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "texturefile.h"
+#include "textures.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	const unsigned char ddsMagic[4] = { 'D', 'D', 'S', ' ' };
+	const unsigned char ktx2Magic[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// DDS layout: magic, 124 byte header, then a 20 byte DX10 header when
+	// the pixel format's four character code is "DX10"
+	const std::size_t ddsHeaderEnd = 128;
+	const std::size_t ddsDx10HeaderEnd = 148;
+	const std::uint32_t ddsdMipMapCount = 0x20000;
+	const std::uint32_t ddpfFourCC = 0x4;
+	const std::uint32_t ddpfRGB = 0x40;
+	const std::uint32_t ddpfAlphaPixels = 0x1;
+	const std::uint32_t ddsCaps2CubeMap = 0x200;
+	const std::uint32_t dxgiTexture2D = 3;
+
+	// KTX2 layout: 80 byte header, then 24 bytes of level index per level
+	const std::size_t ktx2HeaderEnd = 80;
+	const std::size_t ktx2LevelEntry = 24;
+
+	// A format code of either container; channels is 0 for compressed formats
+	struct FormatCode
+	{
+		std::uint32_t code;
+		BlockCompress::Format format;
+		bool srgb;
+		int channels;
+	};
+
+	const FormatCode dxgiFormats[] = {
+		{ 61, BlockCompress::Format::BC1, false, 1 },	// DXGI_FORMAT_R8_UNORM
+		{ 49, BlockCompress::Format::BC1, false, 2 },	// DXGI_FORMAT_R8G8_UNORM
+		{ 28, BlockCompress::Format::BC1, false, 4 },	// DXGI_FORMAT_R8G8B8A8_UNORM
+		{ 71, BlockCompress::Format::BC1, false, 0 },	// DXGI_FORMAT_BC1_UNORM
+		{ 72, BlockCompress::Format::BC1, true, 0 },	// DXGI_FORMAT_BC1_UNORM_SRGB
+		{ 77, BlockCompress::Format::BC3, false, 0 },	// DXGI_FORMAT_BC3_UNORM
+		{ 78, BlockCompress::Format::BC3, true, 0 },	// DXGI_FORMAT_BC3_UNORM_SRGB
+		{ 98, BlockCompress::Format::BC7, false, 0 },	// DXGI_FORMAT_BC7_UNORM
+		{ 99, BlockCompress::Format::BC7, true, 0 },	// DXGI_FORMAT_BC7_UNORM_SRGB
+	};
+
+	const FormatCode vkFormats[] = {
+		{ 9, BlockCompress::Format::BC1, false, 1 },	// VK_FORMAT_R8_UNORM
+		{ 16, BlockCompress::Format::BC1, false, 2 },	// VK_FORMAT_R8G8_UNORM
+		{ 23, BlockCompress::Format::BC1, false, 3 },	// VK_FORMAT_R8G8B8_UNORM
+		{ 37, BlockCompress::Format::BC1, false, 4 },	// VK_FORMAT_R8G8B8A8_UNORM
+		{ 131, BlockCompress::Format::BC1, false, 0 },	// VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		{ 132, BlockCompress::Format::BC1, true, 0 },	// VK_FORMAT_BC1_RGB_SRGB_BLOCK
+		{ 133, BlockCompress::Format::BC1, false, 0 },	// VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+		{ 134, BlockCompress::Format::BC1, true, 0 },	// VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		{ 137, BlockCompress::Format::BC3, false, 0 },	// VK_FORMAT_BC3_UNORM_BLOCK
+		{ 138, BlockCompress::Format::BC3, true, 0 },	// VK_FORMAT_BC3_SRGB_BLOCK
+		{ 145, BlockCompress::Format::BC7, false, 0 },	// VK_FORMAT_BC7_UNORM_BLOCK
+		{ 146, BlockCompress::Format::BC7, true, 0 },	// VK_FORMAT_BC7_SRGB_BLOCK
+	};
+
+	template <std::size_t N>
+	const FormatCode* FindFormat(const FormatCode (&formats)[N], std::uint32_t code)
+	{
+		for (const FormatCode& format : formats)
+		{
+			if (format.code == code)
+				return &format;
+		}
+		return nullptr;
+	}
+
+	// File fields are little endian and not necessarily aligned
+	std::uint32_t Read32(const unsigned char* bytes)
+	{
+		return std::uint32_t(bytes[0]) | std::uint32_t(bytes[1]) << 8 | std::uint32_t(bytes[2]) << 16 | std::uint32_t(bytes[3]) << 24;
+	}
+
+	std::uint64_t Read64(const unsigned char* bytes)
+	{
+		return std::uint64_t(Read32(bytes)) | std::uint64_t(Read32(bytes + 4)) << 32;
+	}
+
+	void Write32(unsigned char* bytes, std::uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes[i] = (unsigned char)(value >> (8 * i));
+	}
+
+	std::uint32_t FourCC(const char* code)
+	{
+		return Read32(reinterpret_cast<const unsigned char*>(code));
+	}
+}
+
+TextureFile::TextureFile()
+	: compressed(false), format(BlockCompress::Format::BC1), srgb(false), channels(4), width(0), height(0)
+{
+}
+
+bool TextureFile::IsContainer(const char* path)
+{
+	const char* extension = std::strrchr(path, '.');
+	if (!extension)
+		return false;
+
+	std::string lower(extension);
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+	return lower == ".dds" || lower == ".ktx2";
+}
+
+///////////////////////////////////////////////////
+//	Open(const char*)
+//
+//	path: DDS or KTX2 file
+//
+//	Map the file and check every level lies inside it before exposing any
+//	pointer
+///////////////////////////////////////////////////
+bool TextureFile::Open(const char* path)
+{
+	Close();
+	this->path = path;
+
+	bool read = false;
+	if (file.Open(path))
+	{
+		if (file.Size() >= sizeof(ddsMagic) && std::memcmp(file.Data(), ddsMagic, sizeof(ddsMagic)) == 0)
+			read = UReadDDS();
+		else if (file.Size() >= sizeof(ktx2Magic) && std::memcmp(file.Data(), ktx2Magic, sizeof(ktx2Magic)) == 0)
+			read = UReadKTX2();
+	}
+
+	if (!read)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void TextureFile::Close()
+{
+	file.Close();
+	levels.clear();
+	width = height = 0;
+}
+
+GLenum TextureFile::InternalFormat() const
+{
+	return compressed ? BlockCompress::InternalFormat(format, srgb) : Textures::InternalFormat(channels);
+}
+
+GLenum TextureFile::PixelFormat() const
+{
+	return Textures::PixelFormat(channels);
+}
+
+std::size_t TextureFile::LevelBytes(int width, int height) const
+{
+	if (compressed)
+		return BlockCompress::LevelBytes(format, width, height);
+	return std::size_t(width) * std::size_t(height) * std::size_t(channels);
+}
+
+///////////////////////////////////////////////////
+//	WriteDDS(const char*)
+//
+//	BC1, BC3 and 3 channel texels use the legacy codes every reader knows;
+//	the other formats need the DX10 header. Written next to path and moved
+//	into place, so a reader never sees a partial file.
+///////////////////////////////////////////////////
+bool TextureFile::WriteDDS(const char* path) const
+{
+	if (levels.empty())
+		return false;
+
+	bool dx10 = compressed ? srgb || format == BlockCompress::Format::BC7 : channels != 3;
+	unsigned char header[ddsDx10HeaderEnd] = {};
+	std::memcpy(header, ddsMagic, sizeof(ddsMagic));
+	Write32(header + 4, 124);
+	Write32(header + 8, 0x1 | 0x2 | 0x4 | 0x1000 | ddsdMipMapCount | 0x80000);	// caps, height, width, format, mips, linear size
+	Write32(header + 12, std::uint32_t(levels[0].height));
+	Write32(header + 16, std::uint32_t(levels[0].width));
+	Write32(header + 20, std::uint32_t(levels[0].size));
+	Write32(header + 28, std::uint32_t(levels.size()));
+	Write32(header + 76, 32);
+	if (!compressed && !dx10)
+	{
+		// bytes in r, g, b order
+		Write32(header + 80, ddpfRGB);
+		Write32(header + 88, 24);
+		Write32(header + 92, 0x0000FF);
+		Write32(header + 96, 0x00FF00);
+		Write32(header + 100, 0xFF0000);
+	}
+	else
+	{
+		Write32(header + 80, ddpfFourCC);
+		Write32(header + 84, dx10 ? FourCC("DX10") : format == BlockCompress::Format::BC1 ? FourCC("DXT1") : FourCC("DXT5"));
+	}
+	Write32(header + 108, levels.size() > 1 ? 0x1000 | 0x8 | 0x400000 : 0x1000);	// texture, complex, mipmap
+
+	if (dx10)
+	{
+		for (const FormatCode& code : dxgiFormats)
+		{
+			if (compressed ? code.channels == 0 && code.format == format && code.srgb == srgb : code.channels == channels)
+				Write32(header + ddsHeaderEnd, code.code);
+		}
+		Write32(header + ddsHeaderEnd + 4, dxgiTexture2D);
+		Write32(header + ddsHeaderEnd + 12, 1);	// array size
+	}
+
+	std::string tempPath = std::string(path) + ".tmp";
+	std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+	if (!file)
+	{
+		std::cout << "Failed to write texture " << tempPath << std::endl;
+		return false;
+	}
+
+	std::size_t headerBytes = dx10 ? ddsDx10HeaderEnd : ddsHeaderEnd;
+	bool written = std::fwrite(header, 1, headerBytes, file) == headerBytes;
+	for (const Level& level : levels)
+		written = written && std::fwrite(level.data, 1, level.size, file) == level.size;
+	written = std::fclose(file) == 0 && written;
+
+	// rename does not replace an existing file on every platform
+	std::remove(path);
+	if (!written || std::rename(tempPath.c_str(), path) != 0)
+	{
+		std::remove(tempPath.c_str());
+		std::cout << "Failed to write texture " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool TextureFile::UReadDDS()
+{
+	const unsigned char* data = file.Data();
+	if (file.Size() < ddsHeaderEnd || Read32(data + 4) != 124)
+		return false;
+
+	std::uint32_t flags = Read32(data + 8);
+	height = int(Read32(data + 12));
+	width = int(Read32(data + 16));
+	std::uint32_t nLevels = (flags & ddsdMipMapCount) && Read32(data + 28) ? Read32(data + 28) : 1;
+	if (Read32(data + 112) & ddsCaps2CubeMap)
+		return false;
+
+	std::uint32_t pixelFlags = Read32(data + 80);
+	std::uint32_t fourCC = Read32(data + 84);
+	std::size_t offset = ddsHeaderEnd;
+	srgb = false;
+	if (!(pixelFlags & ddpfFourCC))
+	{
+		// legacy uncompressed texels, read only in r, g, b(, a) byte order
+		std::uint32_t bits = Read32(data + 88);
+		bool alpha = (pixelFlags & ddpfAlphaPixels) && Read32(data + 104) == 0xFF000000;
+		if (!(pixelFlags & ddpfRGB) || Read32(data + 92) != 0x0000FF || Read32(data + 96) != 0x00FF00
+			|| Read32(data + 100) != 0xFF0000 || !(bits == 24 || (bits == 32 && alpha)))
+			return false;
+		compressed = false;
+		channels = int(bits / 8);
+	}
+	else if (fourCC == FourCC("DXT1") || fourCC == FourCC("DXT5"))
+	{
+		compressed = true;
+		format = fourCC == FourCC("DXT1") ? BlockCompress::Format::BC1 : BlockCompress::Format::BC3;
+	}
+	else if (fourCC == FourCC("DX10") && file.Size() >= ddsDx10HeaderEnd)
+	{
+		const FormatCode* code = FindFormat(dxgiFormats, Read32(data + ddsHeaderEnd));
+		if (!code || Read32(data + ddsHeaderEnd + 4) != dxgiTexture2D || Read32(data + ddsHeaderEnd + 12) > 1)
+			return false;
+		compressed = code->channels == 0;
+		format = code->format;
+		srgb = code->srgb;
+		channels = code->channels;
+		offset = ddsDx10HeaderEnd;
+	}
+	else
+	{
+		return false;
+	}
+
+	if (width < 1 || height < 1 || nLevels > Textures::LevelCount(width, height))
+		return false;
+
+	// levels follow each other, largest first
+	for (std::uint32_t i = 0; i < nLevels; i++)
+	{
+		std::size_t size = LevelBytes(std::max(width >> i, 1), std::max(height >> i, 1));
+		if (!UAddLevel(offset, size))
+			return false;
+		offset += size;
+	}
+	return true;
+}
+
+bool TextureFile::UReadKTX2()
+{
+	const unsigned char* data = file.Data();
+	if (file.Size() < ktx2HeaderEnd)
+		return false;
+
+	const FormatCode* code = FindFormat(vkFormats, Read32(data + 12));
+	width = int(Read32(data + 20));
+	height = int(Read32(data + 24));
+	std::uint32_t depth = Read32(data + 28);
+	std::uint32_t layers = Read32(data + 32);
+	std::uint32_t faces = Read32(data + 36);
+	std::uint32_t nLevels = std::max(Read32(data + 40), 1u);
+	std::uint32_t supercompression = Read32(data + 44);
+
+	if (!code || depth != 0 || layers > 1 || faces != 1 || supercompression != 0
+		|| width < 1 || height < 1 || nLevels > Textures::LevelCount(width, height)
+		|| file.Size() < ktx2HeaderEnd + ktx2LevelEntry * nLevels)
+		return false;
+	compressed = code->channels == 0;
+	format = code->format;
+	srgb = code->srgb;
+	channels = code->channels;
+
+	// the level index lists the largest level first, wherever it is stored
+	for (std::uint32_t i = 0; i < nLevels; i++)
+	{
+		const unsigned char* entry = data + ktx2HeaderEnd + ktx2LevelEntry * i;
+		std::uint64_t offset = Read64(entry);
+		std::uint64_t size = Read64(entry + 8);
+		if (!UAddLevel(std::size_t(offset), std::size_t(size)))
+			return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UAddLevel(std::size_t, std::size_t)
+//
+//	Add the next level if it has the size its format and dimensions call
+//	for and lies inside the file
+///////////////////////////////////////////////////
+bool TextureFile::UAddLevel(std::size_t offset, std::size_t size)
+{
+	int shift = int(levels.size());
+	Level level{ nullptr, size, std::max(width >> shift, 1), std::max(height >> shift, 1) };
+	if (size != LevelBytes(level.width, level.height)
+		|| offset > file.Size() || size > file.Size() - offset)
+		return false;
+
+	level.data = file.Data() + offset;
+	levels.push_back(level);
+	return true;
+}
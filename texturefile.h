@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturefile.h
+// ========
+// GPU-ready textures stored in DDS or KTX2 files, with every mip level
+// ready for glCompressedTexImage2D or glTexImage2D
+//
+// Files are memory-mapped and their levels point into the mapping, so
+// nothing is decoded or copied on the way to the GPU. Only 2D textures are
+// read, in BC1, BC3, BC7 or 8 bits per channel with 1 to 4 channels; KTX2
+// files must not be supercompressed.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "blockcompress.h"
+#include "mappedfile.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class TextureFile
+{
+public:
+	// One mip level, largest first
+	struct Level
+	{
+		const unsigned char* data;
+		std::size_t size;
+		int width;
+		int height;
+	};
+
+	TextureFile();
+
+	// Whether path names a DDS or KTX2 file, by extension
+	static bool IsContainer(const char* path);
+
+	// Map and validate a DDS or KTX2 file, told apart by its signature.
+	// Prints nothing on failure; a missing file is an expected cache miss.
+	bool Open(const char* path);
+	void Close();
+
+	GLenum InternalFormat() const;
+
+	// Pixel format of uncompressed levels
+	GLenum PixelFormat() const;
+
+	// Bytes of a level of width x height texels in this file's format
+	std::size_t LevelBytes(int width, int height) const;
+
+	// Write levels, wherever they point, as a DDS file. Fill in the format
+	// fields and levels of an unopened TextureFile to write data of your own.
+	bool WriteDDS(const char* path) const;
+
+	bool compressed;
+	BlockCompress::Format format;	// When compressed
+	bool srgb;						// When compressed
+	int channels;					// When not compressed
+	int width;
+	int height;
+	std::vector<Level> levels;
+
+private:
+	TextureFile(const TextureFile&) = delete;
+	TextureFile& operator=(const TextureFile&) = delete;
+
+	bool UReadDDS();
+	bool UReadKTX2();
+	bool UAddLevel(std::size_t offset, std::size_t size);
+
+	MappedFile file;
+	std::string path;
+};
@@ -0,0 +1,353 @@
+///////////////////////////////////////////////////////////////////////////////
+// textures.cpp
+// ========
+// image decoding and texture formats, with decoding moved off the GL thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "textures.h"
+#include "gpuresources.h"
+
+// Image owns both what stb_image returns and what Convert() writes, and
+// frees either with std::free
+#define STBI_MALLOC(size) std::malloc(size)
+#define STBI_REALLOC(pointer, size) std::realloc(pointer, size)
+#define STBI_FREE(pointer) std::free(pointer)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>      // Image loading Utility functions
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURES_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+#define TEXTURES_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+namespace
+{
+	// Output bytes each Convert() task writes; small images take one task
+	const std::size_t bandBytes = 256 * 1024;
+
+	// 8 bit sRGB to 8 bit linear
+	struct LinearTable
+	{
+		unsigned char values[256];
+
+		LinearTable()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				double encoded = i / 255.0;
+				double linear = encoded <= 0.04045 ? encoded / 12.92 : std::pow((encoded + 0.055) / 1.055, 2.4);
+				values[i] = (unsigned char)std::lround(linear * 255.0);
+			}
+		}
+	};
+
+	const LinearTable& Linear()
+	{
+		static const LinearTable table;
+		return table;
+	}
+
+	// Weights stb_image uses to turn color into gray
+	unsigned char Luma(const unsigned char* rgb)
+	{
+		return (unsigned char)((rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8);
+	}
+
+	// color * alpha / 255, rounded
+	unsigned char Multiply(unsigned char color, unsigned char alpha)
+	{
+		unsigned product = unsigned(color) * alpha + 128;
+		return (unsigned char)((product + (product >> 8)) >> 8);
+	}
+
+	///////////////////////////////////////////////////
+	//	ConvertRow(const unsigned char*, int, unsigned char*, int, int)
+	//
+	//	Change the channel count of one row; gray to RGBA and RGB to RGBA,
+	//	the common cases, go 16 bytes at a time
+	///////////////////////////////////////////////////
+	void ConvertRow(const unsigned char* src, int srcChannels, unsigned char* dst, int dstChannels, int width)
+	{
+		if (srcChannels == dstChannels)
+		{
+			std::memcpy(dst, src, std::size_t(width) * dstChannels);
+			return;
+		}
+
+		int x = 0;
+#ifdef TEXTURES_SSE
+		const __m128i opaque = _mm_set1_epi32(int(0xFF000000));
+		if (srcChannels == 1 && dstChannels == 4)
+		{
+			for (; x + 16 <= width; x += 16)
+			{
+				__m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+				__m128i pairs[2] = { _mm_unpacklo_epi8(gray, gray), _mm_unpackhi_epi8(gray, gray) };
+				__m128i* out = reinterpret_cast<__m128i*>(dst + std::size_t(x) * 4);
+				for (int i = 0; i < 2; i++)
+				{
+					_mm_storeu_si128(out + 2 * i, _mm_or_si128(_mm_unpacklo_epi16(pairs[i], pairs[i]), opaque));
+					_mm_storeu_si128(out + 2 * i + 1, _mm_or_si128(_mm_unpackhi_epi16(pairs[i], pairs[i]), opaque));
+				}
+			}
+		}
+#endif
+#ifdef TEXTURES_SSSE3
+		if (srcChannels == 3 && dstChannels == 4)
+		{
+			// each load reads 16 bytes for 12, so stop 6 texels short of the end
+			const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+			for (; x + 6 <= width; x += 4)
+			{
+				__m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + std::size_t(x) * 3));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + std::size_t(x) * 4),
+					_mm_or_si128(_mm_shuffle_epi8(rgb, spread), opaque));
+			}
+		}
+#endif
+
+		for (; x < width; x++)
+		{
+			const unsigned char* in = src + std::size_t(x) * srcChannels;
+			unsigned char* out = dst + std::size_t(x) * dstChannels;
+			bool color = srcChannels >= 3;
+			unsigned char alpha = srcChannels == 2 || srcChannels == 4 ? in[srcChannels - 1] : 255;
+			switch (dstChannels)
+			{
+			case 1:
+				out[0] = color ? Luma(in) : in[0];
+				break;
+			case 2:
+				out[0] = color ? Luma(in) : in[0];
+				out[1] = alpha;
+				break;
+			default:
+				out[0] = in[0];
+				out[1] = color ? in[1] : in[0];
+				out[2] = color ? in[2] : in[0];
+				if (dstChannels == 4)
+					out[3] = alpha;
+				break;
+			}
+		}
+	}
+
+	// sRGB to linear in place; 2 and 4 channel images keep alpha as it is
+	void LinearizeRow(unsigned char* row, int channels, int width)
+	{
+		const unsigned char* linear = Linear().values;
+		bool alpha = channels == 2 || channels == 4;
+		std::size_t n = std::size_t(width) * channels;
+		for (std::size_t i = 0; i < n; i++)
+		{
+			if (!alpha || i % channels != std::size_t(channels - 1))
+				row[i] = linear[row[i]];
+		}
+	}
+
+	void PremultiplyRow(unsigned char* row, int channels, int width)
+	{
+		int x = 0;
+#ifdef TEXTURES_SSE
+		if (channels == 4)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i alphaLanes = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+			const __m128i keepAlpha = _mm_and_si128(alphaLanes, _mm_set1_epi16(255));
+			const __m128i half = _mm_set1_epi16(128);
+
+			// two texels as 16 bit lanes, each channel times its alpha, alpha times 255
+			auto multiply = [&](__m128i texels) {
+				__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(texels, 0xFF), 0xFF);
+				alpha = _mm_or_si128(_mm_andnot_si128(alphaLanes, alpha), keepAlpha);
+				__m128i product = _mm_add_epi16(_mm_mullo_epi16(texels, alpha), half);
+				return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+			};
+
+			for (; x + 4 <= width; x += 4)
+			{
+				__m128i* texels = reinterpret_cast<__m128i*>(row + std::size_t(x) * 4);
+				__m128i rgba = _mm_loadu_si128(texels);
+				__m128i lo = multiply(_mm_unpacklo_epi8(rgba, zero));
+				__m128i hi = multiply(_mm_unpackhi_epi8(rgba, zero));
+				_mm_storeu_si128(texels, _mm_packus_epi16(lo, hi));
+			}
+		}
+#endif
+
+		for (; x < width; x++)
+		{
+			unsigned char* texel = row + std::size_t(x) * channels;
+			unsigned char alpha = texel[channels - 1];
+			for (int c = 0; c < channels - 1; c++)
+				texel[c] = Multiply(texel[c], alpha);
+		}
+	}
+}
+
+Textures::Image::Image()
+	: width(0), height(0), channels(0), pixels(nullptr)
+{
+}
+
+Textures::Image::~Image()
+{
+	Free();
+}
+
+Textures::Image::Image(Image&& other) noexcept
+	: path(std::move(other.path)), width(other.width), height(other.height), channels(other.channels), pixels(other.pixels)
+{
+	other.pixels = nullptr;
+}
+
+Textures::Image& Textures::Image::operator=(Image&& other) noexcept
+{
+	if (this != &other)
+	{
+		Free();
+		path = std::move(other.path);
+		width = other.width;
+		height = other.height;
+		channels = other.channels;
+		pixels = other.pixels;
+		other.pixels = nullptr;
+	}
+	return *this;
+}
+
+void Textures::Image::Free()
+{
+	std::free(pixels);
+	pixels = nullptr;
+}
+
+///////////////////////////////////////////////////
+//	Decode(const char*, Image&, const DecodeOptions&, ThreadPool&)
+//
+//	path: JPEG, PNG, or any other format stb_image reads
+//	image: receives the pixels, freed first
+//
+//	stb_image decodes in the file's own channels; flipping (rather than
+//	through stb_image's global flag, which every thread shares), channel
+//	conversion and the rest happen in one Convert() pass. Images that need
+//	none of it are kept as decoded.
+///////////////////////////////////////////////////
+bool Textures::Decode(const char* path, Image& image, const DecodeOptions& options, ThreadPool& pool)
+{
+	image.Free();
+	image.path = path;
+
+	int fileChannels = 0;
+	unsigned char* decoded = stbi_load(path, &image.width, &image.height, &fileChannels, 0);
+	if (!decoded)
+		return false;
+
+	image.channels = options.channels ? options.channels : fileChannels;
+	bool hasAlpha = image.channels == 2 || image.channels == 4;
+	if (image.channels == fileChannels && !options.flipVertically && !options.linearize
+		&& !(options.premultiplyAlpha && hasAlpha))
+	{
+		image.pixels = decoded;
+		return true;
+	}
+
+	image.pixels = static_cast<unsigned char*>(std::malloc(std::size_t(image.width) * image.height * image.channels));
+	if (image.pixels)
+		Convert(decoded, fileChannels, image.pixels, image.width, image.height, options, pool);
+	stbi_image_free(decoded);
+	return image.pixels != nullptr;
+}
+
+///////////////////////////////////////////////////
+//	Convert(const unsigned char*, int, unsigned char*, int, int, const DecodeOptions&, ThreadPool&)
+//
+//	Each output row is written once, straight from its source row, and
+//	finished while it is still in cache
+///////////////////////////////////////////////////
+void Textures::Convert(const unsigned char* src, int srcChannels, unsigned char* dst, int width, int height,
+	const DecodeOptions& options, ThreadPool& pool)
+{
+	int dstChannels = options.channels ? options.channels : srcChannels;
+	std::size_t srcRowBytes = std::size_t(width) * srcChannels;
+	std::size_t dstRowBytes = std::size_t(width) * dstChannels;
+	bool premultiply = options.premultiplyAlpha && (dstChannels == 2 || dstChannels == 4);
+
+	int bandRows = int(std::max<std::size_t>(bandBytes / std::max<std::size_t>(dstRowBytes, 1), 1));
+	std::size_t nBands = std::size_t((height + bandRows - 1) / bandRows);
+	pool.ParallelFor(nBands, [&](std::size_t band) {
+		int first = int(band) * bandRows;
+		int last = std::min(first + bandRows, height);
+		for (int j = first; j < last; j++)
+		{
+			int srcRow = options.flipVertically ? height - 1 - j : j;
+			unsigned char* row = dst + std::size_t(j) * dstRowBytes;
+			ConvertRow(src + std::size_t(srcRow) * srcRowBytes, srcChannels, row, dstChannels, width);
+			if (options.linearize)
+				LinearizeRow(row, dstChannels, width);
+			if (premultiply)
+				PremultiplyRow(row, dstChannels, width);
+		}
+	});
+}
+
+///////////////////////////////////////////////////
+//	InternalFormat(int), PixelFormat(int)
+//
+//	One channel images become GL_R8 / GL_RED, two GL_RG8 / GL_RG, and so on
+///////////////////////////////////////////////////
+GLenum Textures::InternalFormat(int channels)
+{
+	static const GLenum internalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+	return internalFormats[channels - 1];
+}
+
+GLenum Textures::PixelFormat(int channels)
+{
+	static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	return formats[channels - 1];
+}
+
+///////////////////////////////////////////////////
+//	SwizzleGray(GLenum)
+//
+//	GL_R8 and GL_RG8 read back zero green and blue, so without a swizzle
+//	a gray image samples red
+///////////////////////////////////////////////////
+void Textures::SwizzleGray(GLenum format)
+{
+	if (format != GL_RED && format != GL_RG)
+		return;
+
+	const GLint swizzle[] = { GL_RED, GL_RED, GL_RED, format == GL_RG ? GL_GREEN : GL_ONE };
+	glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+GLuint Textures::LevelCount(int width, int height)
+{
+	GLuint levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		levels++;
+	}
+	return levels;
+}
+
+void Textures::Destroy(GLuint& id)
+{
+	if (id)
+		GpuResources::DeleteTextures(1, &id);
+	id = 0;
+}
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// textures.h
+// ========
+// image decoding and texture formats, with decoding moved off the GL thread
+//
+// Decode() and Convert() run on any thread; SwizzleGray() and Destroy()
+// make GL calls and run on the thread owning the context. Textures are
+// created by TextureStreamer, or by TextureAtlas for atlas pages.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "threadpool.h"
+
+#include <cstddef>
+#include <string>
+
+namespace Textures
+{
+	// How files are decoded
+	struct DecodeOptions
+	{
+		int channels = 4;				// 1 to 4, or 0 to keep the file's own
+		bool flipVertically = false;	// First row at the bottom, as GL expects
+		bool linearize = false;			// Convert color from sRGB to linear, alpha untouched
+		bool premultiplyAlpha = false;	// Multiply color by alpha, after linearizing
+	};
+
+	// Pixels of one decoded image, 8 bits per channel, rows tightly packed,
+	// allocated with std::malloc
+	class Image
+	{
+	public:
+		Image();
+		~Image();
+		Image(Image&& other) noexcept;
+		Image& operator=(Image&& other) noexcept;
+
+		void Free();
+
+		std::string path;
+		int width;
+		int height;
+		int channels;
+		unsigned char* pixels;		// Null when decoding failed
+
+	private:
+		Image(const Image&) = delete;
+		Image& operator=(const Image&) = delete;
+	};
+
+	// Decode an image file; safe on any thread, including pool jobs. Large
+	// images are converted in bands of rows on pool.
+	bool Decode(const char* path, Image& image, const DecodeOptions& options = DecodeOptions(),
+		ThreadPool& pool = ThreadPool::Shared());
+
+	// Convert 8 bit texels in one pass: flip, change channel count as
+	// stb_image does (gray expands to RGB, color to gray by luma, missing
+	// alpha is opaque), then linearize and premultiply as options ask.
+	// Runs in bands of rows on pool; src and dst must not overlap.
+	void Convert(const unsigned char* src, int srcChannels, unsigned char* dst, int width, int height,
+		const DecodeOptions& options, ThreadPool& pool = ThreadPool::Shared());
+
+	// GL formats for 8 bit images of 1 to 4 channels
+	GLenum InternalFormat(int channels);
+	GLenum PixelFormat(int channels);
+
+	// Have the bound texture, of pixel format format, sample GL_RED as gray
+	// and GL_RG as gray and alpha, as their RGB and RGBA images would
+	void SwizzleGray(GLenum format);
+
+	// Levels of a full mip chain down to 1x1
+	GLuint LevelCount(int width, int height);
+
+	void Destroy(GLuint& id);
+}
@@ -0,0 +1,805 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ========
+// textures loaded while frames keep rendering, uploaded through a ring of
+// persistently mapped pixel unpack buffers under a per-frame time budget
+///////////////////////////////////////////////////////////////////////////////
+
+#include "texturestreamer.h"
+#include "gpuresources.h"
+#include "meshcache.h"
+#include "texturecache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	// Slice of a blocking fence wait; waits repeat until the fence signals
+	const GLuint64 fenceTimeout = 1000000000;	// Nanoseconds
+
+	// Bump when the texels made from a source change, to retire cache entries
+	const std::uint32_t cacheVersion = 3;
+
+	// Ring offsets are kept to this alignment so copies start on whole lines
+	const std::size_t stagingAlignment = 64;
+
+	// Everything besides the source file that shapes a cache entry
+	std::uint64_t SettingsHash(const Textures::DecodeOptions& options, TextureStreamer::Compression compression,
+		Mipmaps::Filter mipFilter)
+	{
+		const std::uint32_t fields[] = { cacheVersion, std::uint32_t(options.channels), std::uint32_t(options.flipVertically),
+			std::uint32_t(options.linearize), std::uint32_t(options.premultiplyAlpha), std::uint32_t(compression),
+			std::uint32_t(mipFilter) };
+		return MeshCache::Hash(fields, sizeof(fields));
+	}
+}
+
+TextureStreamer::TextureStreamer()
+	: pbo(0), mapped(nullptr), slot(0), slotOpen(false), residentBytes(0), frame(1), nRingFull(0)
+{
+}
+
+///////////////////////////////////////////////////
+//	Create(const Settings&)
+//
+//	Create the staging ring as one immutable pixel unpack buffer, mapped once
+//	for the lifetime of the streamer
+///////////////////////////////////////////////////
+bool TextureStreamer::Create(const Settings& settings)
+{
+	Destroy();
+	this->settings = settings;
+	slots.assign(settings.nSlots, Slot());
+
+	bool bc7 = settings.compression == Compression::BC7;
+	if (settings.compression != Compression::None
+		&& !BlockCompress::Supported(bc7 ? BlockCompress::Format::BC7 : BlockCompress::Format::BC1))
+	{
+		std::cout << "WARNING: " << (bc7 ? "BC7" : "BC1/BC3") << " textures not supported, streaming uncompressed" << std::endl;
+		this->settings.compression = Compression::None;
+	}
+	if (settings.cacheDirectory && !TextureCache::Prepare(settings.cacheDirectory))
+	{
+		std::cout << "WARNING: Cannot create texture cache " << settings.cacheDirectory << ", decoding every time" << std::endl;
+		this->settings.cacheDirectory = nullptr;
+	}
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr ringSize = GLsizeiptr(settings.slotBytes) * settings.nSlots;
+
+	GpuResources::GenBuffers(1, &pbo, "texture streaming ring");
+	GpuResources::SetSize(GpuResources::Kind::Buffer, pbo, std::size_t(ringSize));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ringSize, nullptr, flags);
+	mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ringSize, flags));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (!mapped)
+	{
+		std::cout << "Failed to map texture streaming ring" << std::endl;
+		Destroy();
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Destroy()
+//
+//	Finish the decodes still running, wait for the GPU to finish reading
+//	the ring, then free it
+///////////////////////////////////////////////////
+void TextureStreamer::Destroy()
+{
+	for (Job* job : jobs)
+	{
+		if (job->decoded.valid())
+			job->decoded.wait();
+	}
+	jobs.clear();
+	byId.clear();
+	textures.clear();
+	residentBytes = 0;
+
+	for (Slot& s : slots)
+	{
+		if (s.fence)
+		{
+			glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+			glDeleteSync(s.fence);
+		}
+	}
+	slots.clear();
+
+	// deleting a buffer unmaps it
+	if (pbo)
+		GpuResources::DeleteBuffers(1, &pbo);
+	pbo = 0;
+	mapped = nullptr;
+	slot = 0;
+	slotOpen = false;
+}
+
+///////////////////////////////////////////////////
+//	Load(const char*, const DecodeOptions&, ThreadPool&)
+//
+//	path: any file Textures::Decode() reads
+//
+//	The texture starts as one placeholder texel. Decoding, building the mip
+//	chain and compressing run on pool; Update() picks up the result.
+///////////////////////////////////////////////////
+GLuint TextureStreamer::Load(const char* path, const Textures::DecodeOptions& options, ThreadPool& pool)
+{
+	std::unique_ptr<Job> job(new Job());
+	GpuResources::GenTextures(1, &job->id, path);
+
+	GLint bound = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+	glBindTexture(GL_TEXTURE_2D, job->id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, settings.placeholder);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glBindTexture(GL_TEXTURE_2D, GLuint(bound));
+	GpuResources::SetSize(GpuResources::Kind::Texture, job->id, 4);
+
+	job->path = path;
+	Job* preparing = job.get();
+	Compression compression = settings.compression;
+	Mipmaps::Filter mipFilter = settings.mipFilter;
+	std::string cacheDirectory = settings.cacheDirectory ? settings.cacheDirectory : "";
+	job->decoded = pool.Submit([preparing, options, compression, mipFilter, cacheDirectory, &pool]() {
+		// the one read of the whole file on the way in; it keys the cache
+		// and lets callers find duplicates
+		std::uint64_t key = 0;
+		if (TextureCache::Key(preparing->path.c_str(), SettingsHash(options, compression, mipFilter), key))
+			preparing->contentKey = key;
+		if (TextureFile::IsContainer(preparing->path.c_str()))
+			UPrepareFile(*preparing, preparing->path);
+		else
+			UPrepareImage(*preparing, options, compression, mipFilter, cacheDirectory, pool);
+	});
+
+	GLuint id = job->id;
+	byId[id] = job.get();
+	jobs.push_back(job.get());
+	textures.push_back(std::move(job));
+	return id;
+}
+
+///////////////////////////////////////////////////
+//	Unload(GLuint)
+//
+//	Rows already handed to GL for the texture are fine to delete under;
+//	GL finishes or discards them. Textures of a destroyed streamer are
+//	deleted all the same.
+///////////////////////////////////////////////////
+void TextureStreamer::Unload(GLuint id)
+{
+	auto found = byId.find(id);
+	if (found != byId.end())
+	{
+		Job* job = found->second;
+		if (job->decoded.valid())
+			job->decoded.wait();
+		jobs.erase(std::remove(jobs.begin(), jobs.end(), job), jobs.end());
+		if (job->allocated)
+			residentBytes -= UBytes(*job, job->firstAllocated, int(job->levels.size()) - 1);
+
+		byId.erase(found);
+		textures.erase(std::find_if(textures.begin(), textures.end(),
+			[job](const std::unique_ptr<Job>& texture) { return texture.get() == job; }));
+	}
+
+	GpuResources::DeleteTextures(1, &id);
+}
+
+bool TextureStreamer::Failed(GLuint id) const
+{
+	auto found = byId.find(id);
+	return found != byId.end() && !found->second->queued && !found->second->allocated;
+}
+
+///////////////////////////////////////////////////
+//	ContentKey(GLuint, std::uint64_t&)
+//
+//	The key is written by the decode job, so it is only read once that
+//	job is done; Update() consumes the future when it picks the job up
+///////////////////////////////////////////////////
+bool TextureStreamer::ContentKey(GLuint id, std::uint64_t& key) const
+{
+	auto found = byId.find(id);
+	if (found == byId.end())
+		return false;
+
+	const Job& job = *found->second;
+	if (job.decoded.valid() && job.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return false;
+
+	key = job.contentKey;
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	Request(GLuint, float)
+//
+//	Requests made before the texture is decoded count too, so it can
+//	arrive at the right size
+///////////////////////////////////////////////////
+void TextureStreamer::Request(GLuint id, float screenSize)
+{
+	auto found = byId.find(id);
+	if (found == byId.end())
+		return;
+
+	Job& job = *found->second;
+	if (job.lastUsed != frame)
+	{
+		job.lastUsed = frame;
+		job.screenSize = 0.0f;
+	}
+	job.screenSize = std::max(job.screenSize, screenSize);
+}
+
+///////////////////////////////////////////////////
+//	ScreenSize(const glm::vec3&, const glm::vec3&, const glm::mat4&, const glm::mat4&, const glm::mat4&, int)
+//
+//	Clip space w is the distance along the view axis for a perspective
+//	projection and 1 for an orthographic one, so one formula covers both.
+//	A sphere the camera is inside of fills the viewport.
+///////////////////////////////////////////////////
+float TextureStreamer::ScreenSize(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model,
+	const glm::mat4& view, const glm::mat4& projection, int viewportHeight)
+{
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::mat3 linear(model);
+	float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+	float radius = glm::length(boundsMax - boundsMin) * 0.5f * scale;
+
+	glm::vec4 clip = projection * view * model * glm::vec4(center, 1.0f);
+	bool perspective = projection[3][3] == 0.0f;
+	if (perspective && clip.w < -radius)
+		return 0.0f;
+	if (perspective && clip.w <= radius)
+		return float(viewportHeight);
+	return radius * projection[1][1] * float(viewportHeight) / clip.w;
+}
+
+///////////////////////////////////////////////////
+//	Update()
+//
+//	Work through decoded textures in the order they were loaded, a band of
+//	rows at a time, until budgetMs has passed or every ring slot is still
+//	being read by the GPU. Never waits on a fence or a decode.
+///////////////////////////////////////////////////
+void TextureStreamer::Update()
+{
+	if (!mapped)
+		return;
+
+	GLint bound = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+	UUpdateResidency();
+	if (jobs.empty())
+	{
+		glBindTexture(GL_TEXTURE_2D, GLuint(bound));
+		frame++;
+		return;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point start = Clock::now();
+	auto inBudget = [this, start]() {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count() < settings.budgetMs;
+	};
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	// rows of 1 and 3 channel images are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	auto next = jobs.begin();
+	while (next != jobs.end() && inBudget())
+	{
+		Job& job = **next;
+		if (!job.allocated)
+		{
+			if (job.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				// later files may have finished first
+				++next;
+				continue;
+			}
+
+			job.decoded.get();
+			if (job.levels.empty() || (job.compressed && !BlockCompress::Supported(job.blockFormat)))
+			{
+				std::cout << "Failed to load texture " << job.path << std::endl;
+				job.levels.clear();
+				job.source.clear();
+				job.queued = false;
+				next = jobs.erase(next);
+				continue;
+			}
+
+			// the smallest level goes up with the allocation, so the
+			// texture is never sampled with undefined contents
+			if (!slotOpen && !UAcquireSlot())
+				break;
+			UAllocate(job);
+		}
+
+		if (!UUploadRows(job))
+			break;
+		if (job.level < job.stopLevel)
+		{
+			job.queued = false;
+			next = jobs.erase(next);
+		}
+	}
+
+	// fence this frame's uploads; the slot is reused once the GPU passes it
+	if (slotOpen && slots[slot].used > 0)
+		UReleaseSlot();
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, GLuint(bound));
+	frame++;
+}
+
+///////////////////////////////////////////////////
+//	UAcquireSlot()
+//
+//	Open the current slot for writing if the GPU has finished with it
+///////////////////////////////////////////////////
+bool TextureStreamer::UAcquireSlot()
+{
+	Slot& s = slots[slot];
+	if (s.fence)
+	{
+		GLenum result = glClientWaitSync(s.fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			nRingFull++;
+			return false;
+		}
+		if (result == GL_WAIT_FAILED)
+			std::cout << "WARNING: Texture streaming fence wait failed" << std::endl;
+		glDeleteSync(s.fence);
+		s.fence = 0;
+	}
+
+	s.used = 0;
+	slotOpen = true;
+	return true;
+}
+
+void TextureStreamer::UReleaseSlot()
+{
+	slots[slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slotOpen = false;
+	slot = (slot + 1) % GLuint(slots.size());
+}
+
+///////////////////////////////////////////////////
+//	UAllocate(Job&)
+//
+//	Specify the levels the texture needs that fit the budget, always the
+//	smallest, and start uploading from the smallest. A full chain that can
+//	never be evicted gets immutable storage; the rest stay mutable, so
+//	their levels can be dropped and reloaded.
+///////////////////////////////////////////////////
+void TextureStreamer::UAllocate(Job& job)
+{
+	int lastLevel = int(job.levels.size()) - 1;
+	int first = UWantedLevel(job);
+	while (first < lastLevel && !UMakeRoom(UBytes(job, first, lastLevel), job))
+		first++;
+
+	// a null pointer would be read as an offset into the ring
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, job.id);
+	if (first == 0 && (!settings.budgetBytes || job.source.empty()))
+		glTexStorage2D(GL_TEXTURE_2D, GLsizei(lastLevel + 1), job.internalFormat, job.levels[0].width, job.levels[0].height);
+	else
+		USpecify(job, first, lastLevel);
+	if (!job.compressed)
+		Textures::SwizzleGray(job.format);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, lastLevel);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+
+	residentBytes += UBytes(job, first, lastLevel);
+	GpuResources::SetSize(GpuResources::Kind::Texture, job.id, UBytes(job, first, lastLevel));
+
+	job.allocated = true;
+	job.firstAllocated = first;
+	job.stopLevel = first;
+	job.level = lastLevel;
+	job.row = 0;
+}
+
+///////////////////////////////////////////////////
+//	USpecify(Job&, int, int)
+//
+//	Give levels [first, last] of the bound texture storage at full size,
+//	contents undefined until uploaded
+///////////////////////////////////////////////////
+void TextureStreamer::USpecify(Job& job, int first, int last)
+{
+	for (int i = first; i <= last; i++)
+	{
+		const Level& level = job.levels[i];
+		if (job.compressed)
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, job.internalFormat, level.width, level.height, 0,
+				GLsizei(level.rowBytes * level.rows), nullptr);
+		else
+			glTexImage2D(GL_TEXTURE_2D, i, GLint(job.internalFormat), level.width, level.height, 0,
+				job.format, GL_UNSIGNED_BYTE, nullptr);
+	}
+}
+
+std::size_t TextureStreamer::UBytes(const Job& job, int first, int last)
+{
+	std::size_t bytes = 0;
+	for (int i = first; i <= last; i++)
+		bytes += job.levels[i].rowBytes * job.levels[i].rows;
+	return bytes;
+}
+
+///////////////////////////////////////////////////
+//	UWantedLevel(const Job&)
+//
+//	Finest level the last frame's requests call for: the one with about
+//	one texel per pixel. Unrequested textures want only their smallest.
+///////////////////////////////////////////////////
+int TextureStreamer::UWantedLevel(const Job& job) const
+{
+	int lastLevel = int(job.levels.size()) - 1;
+	if (!settings.budgetBytes || job.source.empty())
+		return 0;
+	if (job.lastUsed != frame || job.screenSize <= 0.0f)
+		return lastLevel;
+
+	float texels = float(std::max(job.levels[0].width, job.levels[0].height));
+	float level = std::floor(std::log2(texels / job.screenSize) + settings.levelBias);
+	return int(std::min(std::max(level, 0.0f), float(lastLevel)));
+}
+
+///////////////////////////////////////////////////
+//	UMakeRoom(std::size_t, const Job&)
+//
+//	Drop the finest levels of other textures until bytes more fit the
+//	budget, least recently requested first. Textures requested last frame
+//	only give up levels finer than they need; every texture keeps at least
+//	its smallest level. Return whether bytes fit.
+///////////////////////////////////////////////////
+bool TextureStreamer::UMakeRoom(std::size_t bytes, const Job& keep)
+{
+	auto fits = [this, bytes]() { return !settings.budgetBytes || residentBytes + bytes <= settings.budgetBytes; };
+	if (fits())
+		return true;
+
+	std::vector<Job*> candidates;
+	for (const std::unique_ptr<Job>& texture : textures)
+	{
+		if (texture.get() != &keep && !texture->queued && !texture->source.empty() && texture->allocated)
+			candidates.push_back(texture.get());
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Job* a, const Job* b) {
+		return a->lastUsed != b->lastUsed ? a->lastUsed < b->lastUsed : a->screenSize < b->screenSize;
+	});
+
+	for (Job* job : candidates)
+	{
+		int keepLevel = UWantedLevel(*job);
+		while (job->firstAllocated < keepLevel && !fits())
+			UDropLevel(*job);
+		if (fits())
+			return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////
+//	UDropLevel(Job&)
+//
+//	Free the finest level of a texture; sampling moves off it first. The
+//	level keeps the texture's format, so every level still matches when
+//	it is reloaded.
+///////////////////////////////////////////////////
+void TextureStreamer::UDropLevel(Job& job)
+{
+	int level = job.firstAllocated;
+	glBindTexture(GL_TEXTURE_2D, job.id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+	if (job.compressed)
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, job.internalFormat, 0, 0, 0, 0, nullptr);
+	else
+		glTexImage2D(GL_TEXTURE_2D, level, GLint(job.internalFormat), 0, 0, 0, job.format, GL_UNSIGNED_BYTE, nullptr);
+
+	residentBytes -= UBytes(job, level, level);
+	job.firstAllocated++;
+	GpuResources::SetSize(GpuResources::Kind::Texture, job.id,
+		UBytes(job, job.firstAllocated, int(job.levels.size()) - 1));
+}
+
+///////////////////////////////////////////////////
+//	UReload(Job&, int)
+//
+//	Map the texture's file again and queue its levels from level up to
+//	the finest it holds, smallest first, as on the first load
+///////////////////////////////////////////////////
+bool TextureStreamer::UReload(Job& job, int level)
+{
+	TextureFile& file = job.file;
+	bool matches = file.Open(job.source.c_str()) && file.levels.size() == job.levels.size();
+	for (std::size_t i = 0; matches && i < job.levels.size(); i++)
+		matches = file.levels[i].size == job.levels[i].rowBytes * job.levels[i].rows;
+	if (!matches)
+	{
+		std::cout << "WARNING: Cannot reload " << job.path << " from " << job.source << ", keeping its levels" << std::endl;
+		file.Close();
+		job.source.clear();
+		return false;
+	}
+	for (std::size_t i = 0; i < job.levels.size(); i++)
+		job.levels[i].data = file.levels[i].data;
+
+	int last = job.firstAllocated - 1;
+	glBindTexture(GL_TEXTURE_2D, job.id);
+	USpecify(job, level, last);
+	residentBytes += UBytes(job, level, last);
+	GpuResources::SetSize(GpuResources::Kind::Texture, job.id,
+		UBytes(job, level, int(job.levels.size()) - 1));
+
+	job.firstAllocated = level;
+	job.stopLevel = level;
+	job.level = last;
+	job.row = 0;
+	job.queued = true;
+	jobs.push_back(&job);
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UUpdateResidency()
+//
+//	Load the levels last frame's requests call for, largest on screen
+//	first, as far as the budget allows. Surplus levels stay until another
+//	texture needs their room.
+///////////////////////////////////////////////////
+void TextureStreamer::UUpdateResidency()
+{
+	if (!settings.budgetBytes)
+		return;
+
+	std::vector<Job*> requested;
+	for (const std::unique_ptr<Job>& texture : textures)
+	{
+		if (texture->lastUsed == frame && !texture->queued && !texture->source.empty() && texture->allocated)
+			requested.push_back(texture.get());
+	}
+	std::sort(requested.begin(), requested.end(), [](const Job* a, const Job* b) {
+		return a->screenSize > b->screenSize;
+	});
+
+	for (Job* job : requested)
+	{
+		int level = UWantedLevel(*job);
+		while (level < job->firstAllocated && !UMakeRoom(UBytes(*job, level, job->firstAllocated - 1), *job))
+			level++;
+		if (level < job->firstAllocated)
+			UReload(*job, level);
+	}
+}
+
+///////////////////////////////////////////////////
+//	UUploadRows(Job&)
+//
+//	Copy as many rows of the current level as fit in the open slot and
+//	upload them from there. Rows of compressed levels are rows of blocks.
+//	Return false when the ring is full.
+///////////////////////////////////////////////////
+bool TextureStreamer::UUploadRows(Job& job)
+{
+	if (!slotOpen && !UAcquireSlot())
+		return false;
+
+	const Level& level = job.levels[job.level];
+	const unsigned char* src = level.data + std::size_t(job.row) * level.rowBytes;
+	Slot& s = slots[slot];
+	int rows = int(std::min(std::size_t(level.rows - job.row), (settings.slotBytes - s.used) / level.rowBytes));
+
+	glBindTexture(GL_TEXTURE_2D, job.id);
+	const void* pixels = src;
+	if (rows > 0)
+	{
+		std::size_t offset = std::size_t(slot) * settings.slotBytes + s.used;
+		std::memcpy(mapped + offset, src, std::size_t(rows) * level.rowBytes);
+		pixels = (const void*)offset;
+		s.used = std::min(settings.slotBytes,
+			(s.used + std::size_t(rows) * level.rowBytes + stagingAlignment - 1) / stagingAlignment * stagingAlignment);
+	}
+	else if (s.used > 0)
+	{
+		// no room left for a row, move on to the next slot
+		UReleaseSlot();
+		return true;
+	}
+	else
+	{
+		// a single row larger than a slot goes up straight from client memory
+		rows = level.rows - job.row;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	int texelRows = job.compressed ? BlockCompress::blockSize : 1;
+	int y = job.row * texelRows;
+	int height = std::min(rows * texelRows, level.height - y);
+	if (job.compressed)
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, level.width, height, job.internalFormat,
+			GLsizei(std::size_t(rows) * level.rowBytes), pixels);
+	else
+		glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, level.width, height, job.format, GL_UNSIGNED_BYTE, pixels);
+	if (pixels == src)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+
+	job.row += rows;
+	if (job.row == level.rows)
+	{
+		// the level is complete, let sampling use it
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+		job.level--;
+		job.row = 0;
+		if (job.level < job.stopLevel)
+		{
+			// sizes stay for the budget; the texels come back from source
+			for (Level& done : job.levels)
+				done.data = nullptr;
+			job.image.Free();
+			job.file.Close();
+			std::vector<unsigned char>().swap(job.mips);
+			std::vector<unsigned char>().swap(job.blocks);
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UPrepareFile(Job&, const std::string&)
+//
+//	path: DDS or KTX2 file, the job's own or its cache entry
+//
+//	Runs on the pool. Levels point into the mapped file.
+///////////////////////////////////////////////////
+bool TextureStreamer::UPrepareFile(Job& job, const std::string& path)
+{
+	TextureFile& file = job.file;
+	if (!file.Open(path.c_str()))
+		return false;
+
+	int texelRows = file.compressed ? BlockCompress::blockSize : 1;
+	for (const TextureFile::Level& level : file.levels)
+	{
+		int rows = (level.height + texelRows - 1) / texelRows;
+		job.levels.push_back(Level{ level.data, level.size / std::size_t(rows), level.width, level.height, rows });
+	}
+	job.source = path;
+	job.compressed = file.compressed;
+	job.blockFormat = file.format;
+	job.internalFormat = file.InternalFormat();
+	job.format = file.PixelFormat();
+	return true;
+}
+
+///////////////////////////////////////////////////
+//	UWriteCache(const Job&, const std::string&)
+//
+//	Save the job's final levels as a cache entry
+///////////////////////////////////////////////////
+bool TextureStreamer::UWriteCache(const Job& job, const std::string& path)
+{
+	TextureFile entry;
+	entry.compressed = job.compressed;
+	entry.format = job.blockFormat;
+	entry.channels = job.image.channels;
+	entry.width = job.levels[0].width;
+	entry.height = job.levels[0].height;
+	for (const Level& level : job.levels)
+		entry.levels.push_back(TextureFile::Level{ level.data, level.rowBytes * level.rows, level.width, level.height });
+	return entry.WriteDDS(path.c_str());
+}
+
+///////////////////////////////////////////////////
+//	UPrepareImage(Job&, const Textures::DecodeOptions&, Compression, Mipmaps::Filter, const std::string&, ThreadPool&)
+//
+//	cacheDirectory: where final levels are kept between runs, empty for none
+//
+//	Runs on the pool: take the levels from the cache entry named after
+//	job.contentKey if it is there, otherwise decode, build the mip chain with mipFilter, block compress
+//	every level if asked to, and save the result to the cache
+///////////////////////////////////////////////////
+void TextureStreamer::UPrepareImage(Job& job, const Textures::DecodeOptions& options, Compression compression,
+	Mipmaps::Filter mipFilter, const std::string& cacheDirectory, ThreadPool& pool)
+{
+	std::string cachePath;
+	if (!cacheDirectory.empty() && job.contentKey)
+	{
+		cachePath = TextureCache::EntryPath(cacheDirectory.c_str(), job.contentKey);
+		if (UPrepareFile(job, cachePath))
+			return;
+	}
+
+	Textures::Image& image = job.image;
+	if (!Textures::Decode(job.path.c_str(), image, options, pool) || image.channels < 1 || image.channels > 4)
+	{
+		image.Free();
+		return;
+	}
+
+	// linearized images are filtered as they are
+	Mipmaps::Options mipOptions;
+	mipOptions.filter = mipFilter;
+	mipOptions.srgb = !options.linearize;
+	job.mips.resize(Mipmaps::ChainBytes(image.width, image.height, image.channels));
+	Mipmaps::Generate(image.pixels, image.width, image.height, image.channels, job.mips.data(), mipOptions, pool);
+
+	GLuint nLevels = Textures::LevelCount(image.width, image.height);
+	int width = image.width;
+	int height = image.height;
+	unsigned char* pixels = image.pixels;
+	for (GLuint i = 0; i < nLevels; i++)
+	{
+		std::size_t rowBytes = std::size_t(width) * image.channels;
+		job.levels.push_back(Level{ pixels, rowBytes, width, height, height });
+		pixels = i == 0 ? job.mips.data() : pixels + rowBytes * height;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	job.internalFormat = Textures::InternalFormat(image.channels);
+	job.format = Textures::PixelFormat(image.channels);
+
+	if (compression != Compression::None)
+		UCompress(job, compression);
+	if (!cachePath.empty() && UWriteCache(job, cachePath))
+		job.source = cachePath;
+}
+
+///////////////////////////////////////////////////
+//	UCompress(Job&, Compression)
+//
+//	Encode every decoded level and point the levels at the blocks instead
+///////////////////////////////////////////////////
+void TextureStreamer::UCompress(Job& job, Compression compression)
+{
+	Textures::Image& image = job.image;
+
+	job.compressed = true;
+	job.blockFormat = compression == Compression::BC7 ? BlockCompress::Format::BC7
+		: BlockCompress::HasAlpha(image.pixels, image.width, image.height, image.channels) ? BlockCompress::Format::BC3
+		: BlockCompress::Format::BC1;
+	job.internalFormat = BlockCompress::InternalFormat(job.blockFormat);
+
+	std::size_t bytes = 0;
+	for (const Level& level : job.levels)
+		bytes += BlockCompress::LevelBytes(job.blockFormat, level.width, level.height);
+	job.blocks.resize(bytes);
+
+	// encode into the block buffer, then point the levels at it
+	unsigned char* blocks = job.blocks.data();
+	std::size_t blockBytes = BlockCompress::BlockBytes(job.blockFormat);
+	for (Level& level : job.levels)
+	{
+		BlockCompress::Encode(job.blockFormat, level.data, level.width, level.height, image.channels, blocks);
+		level.rowBytes = std::size_t(level.width + BlockCompress::blockSize - 1) / BlockCompress::blockSize * blockBytes;
+		level.rows = (level.height + BlockCompress::blockSize - 1) / BlockCompress::blockSize;
+		level.data = blocks;
+		blocks += level.rowBytes * level.rows;
+	}
+	image.Free();
+	std::vector<unsigned char>().swap(job.mips);
+}
@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ========
+// textures loaded while frames keep rendering: files decode on the pool,
+// then their mip levels are copied through a ring of persistently mapped
+// pixel unpack buffers a few at a time, within a per-frame time budget
+//
+// Load() returns a texture name at once. Until the file is decoded it holds
+// a single placeholder texel; after that its smallest mips arrive first and
+// GL_TEXTURE_BASE_LEVEL follows the largest level complete, so the texture
+// sharpens over a few frames instead of stalling one.
+//
+// DDS and KTX2 files are mapped and their block compressed levels streamed
+// as stored. Other images may be block compressed on the pool as well.
+//
+// Under a GPU memory budget, textures keep only the levels their draws need.
+// Request() reports how large each texture appears on screen; levels it
+// needs come back from the texture's DDS or KTX2 file, or its cache entry,
+// while the least recently requested textures give up their finest levels
+// to make room. Dropped levels are re-specified as 0x0 in the texture's own
+// format, which frees their storage; that is why textures that can lose
+// levels keep mutable storage. Those that never do, with no budget or no
+// file to reload from, get immutable storage once decoded.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+#include <glm/glm.hpp>
+
+#include "blockcompress.h"
+#include "mipmaps.h"
+#include "texturefile.h"
+#include "textures.h"
+#include "threadpool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TextureStreamer
+{
+public:
+	// Block compression applied on the pool after decoding
+	enum class Compression
+	{
+		None,		// 8 bits per channel, as decoded
+		BC1OrBC3,	// BC1, or BC3 for images with alpha below 255
+		BC7
+	};
+
+	struct Settings
+	{
+		std::size_t slotBytes = 4 << 20;	// Staging per ring slot; larger levels go up in bands of rows
+		GLuint nSlots = 4;					// Slots in flight before uploads wait for the GPU
+		double budgetMs = 2.0;				// CPU time Update() may spend per frame
+		GLubyte placeholder[4] = { 128, 128, 128, 255 };	// Shown until the first mip arrives
+		Compression compression = Compression::None;		// For decoded images; DDS and KTX2 files keep their own
+		Mipmaps::Filter mipFilter = Mipmaps::Filter::Kaiser;	// Builds the mips of decoded images
+
+		// Final levels of decoded images are kept here between runs and
+		// mapped instead of decoding again. nullptr always decodes.
+		const char* cacheDirectory = "textures.cache";
+
+		// GPU memory streamed textures may hold, 0 for no limit. With a
+		// limit, textures only load levels finer than their smallest as
+		// Request() asks for them, and textures without a file to reload
+		// from (decoded with no cache) always load every level.
+		std::size_t budgetBytes = 0;
+		float levelBias = 0.0f;		// Added to the level Request() asks for; above 0 is blurrier
+	};
+
+	TextureStreamer();
+
+	bool Create() { return Create(Settings()); }
+	bool Create(const Settings& settings);
+
+	// Delete the staging ring; textures already handed out stay valid,
+	// those still streaming keep whatever levels arrived
+	void Destroy();
+
+	// Queue a file and return its texture, usable right away
+	GLuint Load(const char* path, const Textures::DecodeOptions& options = Textures::DecodeOptions(),
+		ThreadPool& pool = ThreadPool::Shared());
+
+	// Delete a texture Load() returned, waiting for its decode if that is
+	// still running. Its name may be reused by the next Load().
+	void Unload(GLuint id);
+
+	// Upload queued levels until the budget is spent or the ring is full.
+	// Call once per frame on the GL thread.
+	void Update();
+
+	// Ask for id to be sharp enough for a draw screenSize pixels across, with
+	// its texture coordinates spanning [0, 1] once. Call for every draw that
+	// samples id, every frame; the next Update() acts on the largest.
+	void Request(GLuint id, float screenSize);
+
+	// Pixels across the bounding sphere of a model space box drawn with
+	// model, view and projection into a viewport viewportHeight pixels tall;
+	// 0 behind the camera
+	static float ScreenSize(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model,
+		const glm::mat4& view, const glm::mat4& projection, int viewportHeight);
+
+	// Nothing queued or decoding
+	bool Idle() const { return jobs.empty(); }
+
+	// The file behind id could not be loaded; it keeps its placeholder
+	bool Failed(GLuint id) const;
+
+	// False until id's file has been read on the pool; then true, with key
+	// the hash of the file and of everything that shapes its texels, or 0
+	// when the file could not be read. Equal keys mean equal textures.
+	bool ContentKey(GLuint id, std::uint64_t& key) const;
+
+	// GPU memory of every level given storage
+	std::size_t ResidentBytes() const { return residentBytes; }
+
+	// Uploads that found every ring slot still in use by the GPU
+	GLuint RingFullCount() const { return nRingFull; }
+
+private:
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// One mip level ready to upload, in rows of texels or of 4x4 blocks
+	struct Level
+	{
+		const unsigned char* data;
+		std::size_t rowBytes;
+		int width;
+		int height;
+		int rows;
+	};
+
+	// One texture on its way in
+	struct Job
+	{
+		GLuint id = 0;
+		std::string path;
+		Textures::Image image;				// Decoded level 0
+		std::vector<unsigned char> mips;	// Decoded levels 1 and up
+		std::vector<unsigned char> blocks;	// Every level, block compressed
+		TextureFile file;					// Mapped DDS or KTX2 file
+		std::vector<Level> levels;			// Into one of the above, largest first; empty on failure
+		bool compressed = false;
+		BlockCompress::Format blockFormat = BlockCompress::Format::BC1;
+		GLenum internalFormat = 0;
+		GLenum format = 0;					// Pixel format of uncompressed levels
+		std::future<void> decoded;
+		std::string source;					// DDS or KTX2 file levels are read back from, empty if none
+		std::uint64_t contentKey = 0;		// Hash of the file and settings, 0 if unreadable; set on the pool
+		bool allocated = false;				// Storage specified
+		bool queued = true;					// In jobs, decoding or uploading
+		int firstAllocated = -1;			// Finest level with storage
+		int stopLevel = 0;					// Finest level the current upload goes to
+		int level = -1;						// Level being uploaded
+		int row = 0;						// Next row of level
+		float screenSize = 0.0f;			// Largest Request() of frame lastUsed
+		std::uint64_t lastUsed = 0;			// Frame of the last Request(), 0 for never
+	};
+
+	struct Slot
+	{
+		GLsync fence = 0;	// Behind the last upload reading the slot
+		std::size_t used = 0;
+	};
+
+	bool UAcquireSlot();
+	void UReleaseSlot();
+	bool UUploadRows(Job& job);
+	void UAllocate(Job& job);
+	void USpecify(Job& job, int first, int last);
+	void UDropLevel(Job& job);
+	bool UReload(Job& job, int level);
+	bool UMakeRoom(std::size_t bytes, const Job& keep);
+	int UWantedLevel(const Job& job) const;
+	void UUpdateResidency();
+	static std::size_t UBytes(const Job& job, int first, int last);
+	static bool UPrepareFile(Job& job, const std::string& path);
+	static void UPrepareImage(Job& job, const Textures::DecodeOptions& options, Compression compression,
+		Mipmaps::Filter mipFilter, const std::string& cacheDirectory, ThreadPool& pool);
+	static void UCompress(Job& job, Compression compression);
+	static bool UWriteCache(const Job& job, const std::string& path);
+
+	Settings settings;
+	GLuint pbo;
+	unsigned char* mapped;		// Persistent mapping of the whole ring
+	std::vector<Slot> slots;
+	GLuint slot;				// Slot being filled
+	bool slotOpen;				// slot waited on and accepting uploads
+	std::vector<std::unique_ptr<Job>> textures;		// Every texture handed out
+	std::unordered_map<GLuint, Job*> byId;
+	std::deque<Job*> jobs;		// Decoding or uploading, in the order queued
+	std::size_t residentBytes;
+	std::uint64_t frame;		// Update() calls so far, plus one
+	GLuint nRingFull;
+};
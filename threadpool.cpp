@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ========
+// fixed set of worker threads for CPU work done at load time: mesh
+// generation, asset decoding
+///////////////////////////////////////////////////////////////////////////////
+
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(unsigned nThreads)
+	: stopping(false)
+{
+	if (nThreads == 0)
+		nThreads = std::thread::hardware_concurrency();
+	if (nThreads == 0)
+		nThreads = 1;
+
+	workers.reserve(nThreads);
+	for (unsigned i = 0; i < nThreads; i++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+///////////////////////////////////////////////////
+//	~ThreadPool()
+//
+//	Finish the queued jobs, then join the workers
+///////////////////////////////////////////////////
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		stopping = true;
+	}
+	jobsReady.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+///////////////////////////////////////////////////
+//	ParallelFor(std::size_t, const std::function<void(std::size_t)>&)
+//
+//	Every participant claims task indices from a shared counter until none
+//	are left. Helpers that only start after the caller returns find the
+//	counter exhausted and never touch task, which may be gone by then.
+///////////////////////////////////////////////////
+void ThreadPool::ParallelFor(std::size_t nTasks, const std::function<void(std::size_t)>& task)
+{
+	if (nTasks == 0)
+		return;
+
+	struct Shared
+	{
+		const std::function<void(std::size_t)>* task;
+		std::size_t nTasks;
+		std::atomic<std::size_t> next{ 0 };
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::size_t nFinished = 0;
+		std::exception_ptr error;
+	};
+	std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+	shared->task = &task;
+	shared->nTasks = nTasks;
+
+	auto run = [shared]() {
+		for (;;)
+		{
+			std::size_t i = shared->next++;
+			if (i >= shared->nTasks)
+				return;
+
+			std::exception_ptr error;
+			try
+			{
+				(*shared->task)(i);
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(shared->mutex);
+			if (error && !shared->error)
+				shared->error = error;
+			if (++shared->nFinished == shared->nTasks)
+				shared->finished.notify_all();
+		}
+	};
+
+	std::size_t nHelpers = std::min(nTasks - 1, workers.size());
+	for (std::size_t i = 0; i < nHelpers; i++)
+		Enqueue(run);
+	run();
+
+	std::unique_lock<std::mutex> lock(shared->mutex);
+	shared->finished.wait(lock, [&shared]() { return shared->nFinished == shared->nTasks; });
+	if (shared->error)
+		std::rethrow_exception(shared->error);
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		jobs.push_back(std::move(job));
+	}
+	jobsReady.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobsMutex);
+			jobsReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		// packaged_task stores any exception in the job's future
+		job();
+	}
+}
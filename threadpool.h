@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ========
+// fixed set of worker threads for CPU work done at load time: mesh
+// generation, asset decoding
+//
+// Jobs must not make GL calls; only the thread owning the context may.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// nThreads of 0 uses one worker per hardware thread
+	explicit ThreadPool(unsigned nThreads = 0);
+	~ThreadPool();
+
+	// Pool shared by the whole program, created on first use
+	static ThreadPool& Shared();
+
+	unsigned ThreadCount() const { return unsigned(workers.size()); }
+
+	// Queue job; the future returns its result or rethrows its exception
+	template <typename Job>
+	auto Submit(Job job) -> std::future<decltype(job())>
+	{
+		typedef decltype(job()) Result;
+		std::shared_ptr<std::packaged_task<Result()>> task =
+			std::make_shared<std::packaged_task<Result()>>(std::move(job));
+		std::future<Result> result = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	// Run task(0) to task(nTasks - 1) on the calling thread and on idle
+	// workers, and return once all have run; rethrows the first exception.
+	// Safe inside a job: the caller only waits for tasks already started,
+	// never for queued helpers, so a busy pool cannot deadlock it.
+	void ParallelFor(std::size_t nTasks, const std::function<void(std::size_t)>& task);
+
+private:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Enqueue(std::function<void()> job);
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobsMutex;
+	std::condition_variable jobsReady;
+	bool stopping;
+};
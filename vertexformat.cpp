@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.cpp
+// ========
+// vertex layouts understood by the surface shaders, and conversion from the
+// interleaved float layout to the packed one
+///////////////////////////////////////////////////////////////////////////////
+
+#include "vertexformat.h"
+#include "primitives.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// the layout offsets are what the attribute formats use; PackVertices()
+// writes through the struct, so the two must agree
+static_assert(VertexFormat::PackedLayout::Offset<0>() == offsetof(VertexFormat::PackedVertex, position)
+	&& VertexFormat::PackedLayout::Offset<1>() == offsetof(VertexFormat::PackedVertex, normal)
+	&& VertexFormat::PackedLayout::Offset<2>() == offsetof(VertexFormat::PackedVertex, uv),
+	"PackedVertex does not match PackedLayout");
+
+namespace
+{
+	GLshort FloatToSnorm16(float value)
+	{
+		if (value > 1.0f)
+			value = 1.0f;
+		if (value < -1.0f)
+			value = -1.0f;
+		return GLshort(std::lround(value * 32767.0f));
+	}
+}
+
+///////////////////////////////////////////////////
+//	FloatToHalf(float)
+//
+//	Convert to IEEE 754 half precision, rounding to nearest even
+///////////////////////////////////////////////////
+GLhalf VertexFormat::FloatToHalf(float value)
+{
+	GLuint bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	GLuint sign = (bits >> 16) & 0x8000;
+	GLuint exponent = (bits >> 23) & 0xff;
+	GLuint mantissa = bits & 0x7fffff;
+
+	// infinity and NaN
+	if (exponent == 0xff)
+		return GLhalf(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+	int halfExponent = int(exponent) - 127 + 15;
+	if (halfExponent >= 31)
+		return GLhalf(sign | 0x7c00);
+
+	// denormals, or zero when too small
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+			return GLhalf(sign);
+
+		mantissa |= 0x800000;
+		GLuint shift = GLuint(14 - halfExponent);
+		GLuint half = mantissa >> shift;
+		GLuint remainder = mantissa & ((1u << shift) - 1);
+		GLuint halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return GLhalf(sign | half);
+	}
+
+	// a carry out of the mantissa correctly bumps the exponent
+	GLuint half = (GLuint(halfExponent) << 10) | (mantissa >> 13);
+	GLuint remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+	return GLhalf(sign | half);
+}
+
+///////////////////////////////////////////////////
+//	OctEncode(float, float, float, GLshort[2])
+//
+//	Map a unit normal onto the octahedron and unfold the lower half over
+//	the upper one, giving two snorm16 values. The vertex shader reverses
+//	this when ubOctNormals is set. A zero normal, from a degenerate
+//	triangle, has no direction and encodes as (0, 0).
+///////////////////////////////////////////////////
+void VertexFormat::OctEncode(float nx, float ny, float nz, GLshort out[2])
+{
+	float l1 = std::fabs(nx) + std::fabs(ny) + std::fabs(nz);
+	if (!(l1 > 0.0f))
+	{
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+
+	float x = nx / l1;
+	float y = ny / l1;
+
+	if (nz < 0.0f)
+	{
+		float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	out[0] = FloatToSnorm16(x);
+	out[1] = FloatToSnorm16(y);
+}
+
+///////////////////////////////////////////////////
+//	PackVertices(const GLfloat*, GLuint, PackedVertex*)
+//
+//	verts: interleaved position, normal and texture coords
+//	out: receives nVertices packed vertices
+///////////////////////////////////////////////////
+void VertexFormat::PackVertices(const GLfloat* verts, GLuint nVertices, PackedVertex* out)
+{
+	for (GLuint v = 0; v < nVertices; v++)
+	{
+		const GLfloat* in = verts + v * Primitives::floatsPerElement;
+		PackedVertex& packed = out[v];
+
+		const GLfloat* position = in + Primitives::positionOffset;
+		const GLfloat* normal = in + Primitives::normalOffset;
+		const GLfloat* uv = in + Primitives::uvOffset;
+
+		packed.position[0] = FloatToHalf(position[0]);
+		packed.position[1] = FloatToHalf(position[1]);
+		packed.position[2] = FloatToHalf(position[2]);
+		packed.position[3] = FloatToHalf(1.0f);
+		OctEncode(normal[0], normal[1], normal[2], packed.normal);
+		packed.uv[0] = FloatToHalf(uv[0]);
+		packed.uv[1] = FloatToHalf(uv[1]);
+	}
+}
+
+///////////////////////////////////////////////////
+//	PackIndices(const GLuint*, GLuint, GLushort*)
+//
+//	Narrow indices to 16 bits; only valid for meshes of up to 65536 vertices
+///////////////////////////////////////////////////
+void VertexFormat::PackIndices(const GLuint* indices, GLuint nIndices, GLushort* out)
+{
+	for (GLuint i = 0; i < nIndices; i++)
+		out[i] = GLushort(indices[i]);
+}
+
+///////////////////////////////////////////////////
+//	SetupFloatFormat(GLuint)
+//
+//	binding: vertex buffer binding point the attributes read from
+//
+//	Attribute formats for the interleaved float layout
+///////////////////////////////////////////////////
+void VertexFormat::SetupFloatFormat(GLuint binding)
+{
+	FloatLayout::Setup(binding);
+}
+
+///////////////////////////////////////////////////
+//	SetupPackedFormat(GLuint)
+//
+//	binding: vertex buffer binding point the attributes read from
+//
+//	Attribute formats for PackedVertex. The normal arrives in the shader as
+//	(x, y, 0) and is decoded there.
+///////////////////////////////////////////////////
+void VertexFormat::SetupPackedFormat(GLuint binding)
+{
+	PackedLayout::Setup(binding);
+}
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.h
+// ========
+// vertex layouts understood by the surface shaders, and conversion from the
+// interleaved float layout to the packed one
+//
+// Float layout, 32 bytes:  position 3 x float, normal 3 x float, uv 2 x float
+// Packed layout, 16 bytes: position 4 x half (w unused), normal 2 x snorm16
+//                          octahedral, uv 2 x half
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include "vertexlayout.h"
+
+namespace VertexFormat
+{
+	// Locations match the surface shaders: 0 position, 1 normal, 2 uv
+	typedef VertexLayout<
+		VertexAttribute<0, 3, GL_FLOAT>,
+		VertexAttribute<1, 3, GL_FLOAT>,
+		VertexAttribute<2, 2, GL_FLOAT>> FloatLayout;
+
+	// Position is stored as 4 halves for alignment, the shader reads 3
+	typedef VertexLayout<
+		VertexAttribute<0, 3, GL_HALF_FLOAT, GL_FALSE, 4>,
+		VertexAttribute<1, 2, GL_SHORT, GL_TRUE>,
+		VertexAttribute<2, 2, GL_HALF_FLOAT>> PackedLayout;
+
+	struct PackedVertex
+	{
+		GLhalf position[4];
+		GLshort normal[2];
+		GLhalf uv[2];
+	};
+
+	GLhalf FloatToHalf(float value);
+	void OctEncode(float nx, float ny, float nz, GLshort out[2]);
+
+	void PackVertices(const GLfloat* verts, GLuint nVertices, PackedVertex* out);
+	void PackIndices(const GLuint* indices, GLuint nIndices, GLushort* out);
+
+	// Bytes between consecutive vertices of each layout
+	const GLsizei floatStride = FloatLayout::stride;
+	const GLsizei packedStride = PackedLayout::stride;
+
+	static_assert(PackedLayout::stride == sizeof(PackedVertex), "PackedVertex does not match PackedLayout");
+
+	// Attribute formats for the VAO currently bound, all sourced from the
+	// given vertex buffer binding point
+	void SetupFloatFormat(GLuint binding);
+	void SetupPackedFormat(GLuint binding);
+}
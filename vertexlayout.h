@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexlayout.h
+// ========
+// interleaved vertex layouts described at compile time: attribute offsets,
+// the stride and the VAO attribute format calls all follow from the list of
+// attributes, so they cannot drift apart
+//
+// typedef VertexLayout<VertexAttribute<0, 3, GL_FLOAT>, VertexAttribute<1, 2, GL_FLOAT>> Layout;
+// Layout::stride == 20, Layout::Offset<1>() == 12, Layout::Setup(binding)
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>        // GLEW library
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+// Bytes per component of a vertex attribute type, 0 for types no layout uses
+constexpr GLuint VertexComponentSize(GLenum type)
+{
+	return type == GL_FLOAT ? 4
+		: type == GL_HALF_FLOAT || type == GL_SHORT || type == GL_UNSIGNED_SHORT ? 2
+		: type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1
+		: 0;
+}
+
+// One attribute: shader location, components the shader reads, their type,
+// and how many components are stored (more than read when padded)
+template <GLuint Location, GLint Components, GLenum Type, GLboolean Normalized = GL_FALSE, GLint StoredComponents = Components>
+struct VertexAttribute
+{
+	static_assert(VertexComponentSize(Type) > 0, "unsupported vertex attribute type");
+	static_assert(Components >= 1 && Components <= 4 && StoredComponents >= Components, "bad vertex attribute size");
+
+	static constexpr GLuint location = Location;
+	static constexpr GLint components = Components;
+	static constexpr GLenum type = Type;
+	static constexpr GLboolean normalized = Normalized;
+	static constexpr GLuint size = GLuint(StoredComponents) * VertexComponentSize(Type);	// Bytes
+};
+
+template <typename... Attributes>
+struct VertexLayout
+{
+	static_assert(sizeof...(Attributes) > 0, "a vertex layout needs attributes");
+
+	static constexpr GLuint count = GLuint(sizeof...(Attributes));
+	static constexpr GLsizei stride = GLsizei((Attributes::size + ...));
+
+	// Attribute i of the list
+	template <GLuint i>
+	using Attribute = typename std::tuple_element<i, std::tuple<Attributes...>>::type;
+
+	// Byte offset of attribute i within a vertex
+	template <GLuint i>
+	static constexpr GLuint Offset()
+	{
+		static_assert(i < count, "attribute index out of range");
+		constexpr GLuint sizes[] = { Attributes::size... };
+		GLuint offset = 0;
+		for (GLuint a = 0; a < i; a++)
+			offset += sizes[a];
+		return offset;
+	}
+
+	// Every attribute uses the given type; layouts addressed as plain arrays
+	// of that type must be
+	static constexpr bool AllOfType(GLenum type)
+	{
+		return ((Attributes::type == type) && ...);
+	}
+
+	// Attribute formats for the VAO currently bound, all sourced from the
+	// given vertex buffer binding point
+	static void Setup(GLuint binding)
+	{
+		USetup(binding, std::make_index_sequence<sizeof...(Attributes)>());
+	}
+
+private:
+	static constexpr bool UniqueLocations()
+	{
+		constexpr GLuint locations[] = { Attributes::location... };
+		for (GLuint a = 0; a < count; a++)
+			for (GLuint b = a + 1; b < count; b++)
+				if (locations[a] == locations[b])
+					return false;
+		return true;
+	}
+	static_assert(UniqueLocations(), "two attributes share a shader location");
+
+	template <std::size_t... i>
+	static void USetup(GLuint binding, std::index_sequence<i...>)
+	{
+		(USetupAttribute<Attribute<GLuint(i)>>(binding, Offset<GLuint(i)>()), ...);
+	}
+
+	template <typename A>
+	static void USetupAttribute(GLuint binding, GLuint offset)
+	{
+		glVertexAttribFormat(A::location, A::components, A::type, A::normalized, offset);
+		glVertexAttribBinding(A::location, binding);
+		glEnableVertexAttribArray(A::location);
+	}
+};